@@ -0,0 +1,132 @@
+//Counts heap allocations, to keep the frame loop from making any
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include "SDL2/SDL.h"
+
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+/**
+ * Build with -DTRACK_ALLOCATIONS to count every operator new and delete.
+ * The counts are shared by every thread, so a frame's count includes
+ * whatever the simulation did while it was being drawn. Without the flag
+ * nothing is replaced and the counts stay at 0
+ */
+static SDL_atomic_t allocationCount;
+static SDL_atomic_t allocationBytes;
+static SDL_atomic_t freeCount;
+
+#ifdef TRACK_ALLOCATIONS
+void *operator new(size_t size) {
+	SDL_AtomicAdd(&allocationCount, 1);
+	SDL_AtomicAdd(&allocationBytes, (int)size);
+	void *memory = malloc(size ? size : 1);
+	if(!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+void *operator new(size_t size, std::nothrow_t const &) noexcept {
+	SDL_AtomicAdd(&allocationCount, 1);
+	SDL_AtomicAdd(&allocationBytes, (int)size);
+	return malloc(size ? size : 1);
+}
+void *operator new[](size_t size, std::nothrow_t const &tag) noexcept {
+	return operator new(size, tag);
+}
+void operator delete(void *memory) noexcept {
+	if(memory)
+		SDL_AtomicAdd(&freeCount, 1);
+	free(memory);
+}
+void operator delete[](void *memory) noexcept {
+	operator delete(memory);
+}
+void operator delete(void *memory, size_t) noexcept {
+	operator delete(memory);
+}
+void operator delete[](void *memory, size_t) noexcept {
+	operator delete(memory);
+}
+#endif
+
+/**
+ * Allocations so far, wrapping around on very long runs, so only differences mean anything
+ */
+Uint32 allocationsSoFar() {
+	return (Uint32)SDL_AtomicGet(&allocationCount);
+}
+
+/**
+ * Keeps per frame allocation counts for the frames that should have none,
+ * like steady play, and reports how often they didn't
+ */
+class FrameAllocations {
+	private:
+	Uint32 start;
+	Uint32 startBytes;
+	//the last frame's counts, and totals over every counted frame
+	Uint32 last;
+	Uint32 lastBytes;
+	Uint64 frames;
+	Uint64 framesAllocating;
+	Uint64 total;
+	Uint32 worst;
+
+	public:
+	FrameAllocations() {
+		start = 0;
+		startBytes = 0;
+		last = 0;
+		lastBytes = 0;
+		frames = 0;
+		framesAllocating = 0;
+		total = 0;
+		worst = 0;
+	}
+
+	void begin() {
+		start = allocationsSoFar();
+		startBytes = (Uint32)SDL_AtomicGet(&allocationBytes);
+	}
+
+	/**
+	 * Close the frame off, counting it only if it's one that shouldn't allocate
+	 */
+	void end(bool counted) {
+		last = allocationsSoFar() - start;
+		lastBytes = (Uint32)SDL_AtomicGet(&allocationBytes) - startBytes;
+		if(!counted)
+			return;
+		frames++;
+		total += last;
+		framesAllocating += last > 0;
+		worst = last > worst ? last : worst;
+	}
+
+	Uint32 getLast() {
+		return last;
+	}
+	Uint32 getLastBytes() {
+		return lastBytes;
+	}
+	Uint64 getTotal() {
+		return total;
+	}
+
+	void report(std::string name) {
+#ifdef TRACK_ALLOCATIONS
+		printf("%s allocations: %llu over %llu frames, %llu frames allocated, worst frame %u\n", name.c_str(),
+				(unsigned long long)total, (unsigned long long)frames, (unsigned long long)framesAllocating, worst);
+#else
+		(void)name;
+#endif
+	}
+};
+
+#endif
@@ -0,0 +1,126 @@
+//Animation clips loaded from a data file and sampled by simulation tick
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "AssetPack.h"
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+/**
+ * One animation: a named sprite sheet whose frames are each shown for some
+ * number of ticks. Durations live in the owning set's flat array
+ */
+struct AnimationClip {
+	std::string name;
+	int firstDuration;
+	int frames;
+	int length;
+};
+
+/**
+ * Every clip for one kind of entity. Entities only need to remember which
+ * clip they are in and how many ticks they have spent in it, so sampling
+ * is a short walk over durations and never allocates
+ */
+class AnimationSet {
+	private:
+	std::vector<AnimationClip> clips;
+	std::vector<int> durations;
+	std::vector<std::string> names;
+	std::vector<int> frameCounts;
+	
+	public:
+	AnimationSet(std::string filename) {
+		char *text = loadText(filename);
+		if(!text) {
+			throw;
+		}
+		char *cursor = text;
+		char *line;
+		while((line = nextLine(&cursor))) {
+			char name[64] = { 0 };
+			int frames = 0;
+			int read = 0;
+			if(line[0] == '#' || sscanf(line, "%63s %d%n", name, &frames, &read) < 2 || frames < 1)
+				continue;
+			AnimationClip clip;
+			clip.name = name;
+			clip.firstDuration = durations.size();
+			clip.frames = frames;
+			clip.length = 0;
+			//frames with no duration are skipped over, only a clip that's 0 long
+			//altogether stays on its first frame. The clip is kept either way,
+			//since clips are sheets of the atlas in file order
+			char *cursor = line + read;
+			int given = 0;
+			for(int i = 0; i < frames; i++) {
+				int duration = 0;
+				int used = 0;
+				if(sscanf(cursor, "%d%n", &duration, &used) == 1) {
+					cursor += used;
+					given++;
+				}
+				duration = duration > 0 ? duration : 0;
+				durations.push_back(duration);
+				clip.length += duration;
+			}
+			int extra = 0;
+			if(given == frames && sscanf(cursor, "%d", &extra) == 1)
+				given++;
+			if(given != frames)
+				printf("Animation '%s' has %d frames but %s durations\n", name, frames, given > frames ? "more" : "fewer");
+			else if(frames > 1 && clip.length > 0) {
+				for(int i = 0; i < frames; i++) {
+					if(!durations[clip.firstDuration + i])
+						printf("Frame %d of animation '%s' has no duration, so it's never shown\n", i, name);
+				}
+			}
+			clips.push_back(clip);
+			names.push_back(clip.name);
+			frameCounts.push_back(frames);
+		}
+		SDL_free(text);
+	}
+	
+	int findClip(std::string name) {
+		for(unsigned int i = 0; i < clips.size(); i++) {
+			if(clips[i].name == name)
+				return i;
+		}
+		return -1;
+	}
+	
+	/**
+	 * Which frame of a clip to show after the given number of ticks in it
+	 */
+	int frameAt(int clip, unsigned int ticks) {
+		if(clip < 0 || clip >= (int)clips.size())
+			return 0;
+		AnimationClip const &c = clips[clip];
+		if(c.length == 0)
+			return 0;
+		unsigned int t = ticks % c.length;
+		for(int i = 0; i < c.frames; i++) {
+			unsigned int duration = durations[c.firstDuration + i];
+			if(t < duration)
+				return i;
+			t -= duration;
+		}
+		return c.frames - 1;
+	}
+	
+	int getCount() {
+		return clips.size();
+	}
+	
+	std::vector<std::string> &getNames() {
+		return names;
+	}
+	
+	std::vector<int> &getFrameCounts() {
+		return frameCounts;
+	}
+};
+
+#endif
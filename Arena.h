@@ -0,0 +1,184 @@
+//Memory for groups of objects that are all thrown away together
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <cstring>
+#include <cstdlib>
+#include <type_traits>
+#include "SDL2/SDL.h"
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * Arenas take memory from the heap this much at a time, anything bigger gets a block to itself
+ */
+size_t const ARENA_BLOCK_BYTES = 64*1024;
+
+/**
+ * Whether an object made in an arena needs its destructor run on reset. Types
+ * whose destructor does nothing once their memory is the arena's can say so
+ * per object with a specialization, so getting rid of them costs nothing
+ */
+template<class T>
+bool arenaNeedsCleanup(T const *object) {
+	return !std::is_trivially_destructible<T>::value;
+}
+
+/**
+ * Hands out memory for things that share one lifetime, like everything a
+ * level or a set of menus is made of. Objects are made with make() and never
+ * deleted one by one, reset() runs their destructors newest first and keeps
+ * the memory to hand out again, so building the same things over doesn't
+ * touch the heap or leave it fragmented. Plain data with no destructor costs
+ * nothing to get rid of
+ */
+class Arena {
+	private:
+	struct Block {
+		char *memory;
+		size_t size;
+	};
+	//destructors to run, kept in the arena itself as a list, newest first
+	struct Cleanup {
+		void (*destroy)(void *object);
+		void *object;
+		Cleanup *next;
+	};
+	std::vector<Block> blocks;
+	//the block being handed out from and how much of it is gone
+	unsigned int current;
+	size_t used;
+	Cleanup *cleanups;
+	//what's in the arena now and the most there has been, for report()
+	size_t bytes;
+	size_t peakBytes;
+	unsigned int objects;
+	unsigned int peakObjects;
+	unsigned int resets;
+
+	template<class T>
+	static void destroy(void *object) {
+		((T*)object)->~T();
+	}
+
+	public:
+	Arena() {
+		current = 0;
+		used = 0;
+		cleanups = nullptr;
+		bytes = 0;
+		peakBytes = 0;
+		objects = 0;
+		peakObjects = 0;
+		resets = 0;
+	}
+	~Arena() {
+		reset();
+		for(unsigned int i = 0; i < blocks.size(); i++) {
+			free(blocks[i].memory);
+		}
+	}
+
+	/**
+	 * Raw memory, aligned to align, which has to be a power of two
+	 */
+	void *allocate(size_t size, size_t align) {
+		//blocks come from malloc so are aligned for anything, only the offset needs rounding
+		for(; current < blocks.size(); current++, used = 0) {
+			size_t start = (used + align - 1) & ~(align - 1);
+			if(start + size <= blocks[current].size) {
+				used = start + size;
+				bytes += size;
+				peakBytes = std::max(peakBytes, bytes);
+				return blocks[current].memory + start;
+			}
+		}
+		Block block = { nullptr, std::max(size, ARENA_BLOCK_BYTES) };
+		block.memory = (char*)malloc(block.size);
+		if(!block.memory) {
+			printf("Arena couldn't get %lu more bytes\n", (unsigned long)block.size);
+			throw;
+		}
+		blocks.push_back(block);
+		current = blocks.size() - 1;
+		used = size;
+		bytes += size;
+		peakBytes = std::max(peakBytes, bytes);
+		return block.memory;
+	}
+
+	/**
+	 * Construct a T in the arena. It lasts until the next reset(), which runs its destructor
+	 */
+	template<class T, class... Args>
+	T *make(Args&&... args) {
+		T *object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		//registered after the constructor, so anything it made in here goes after it
+		if(arenaNeedsCleanup<T>(object)) {
+			Cleanup *cleanup = (Cleanup*)allocate(sizeof(Cleanup), alignof(Cleanup));
+			cleanup->destroy = destroy<T>;
+			cleanup->object = object;
+			cleanup->next = cleanups;
+			cleanups = cleanup;
+		}
+		objects++;
+		peakObjects = std::max(peakObjects, objects);
+		return object;
+	}
+
+	/**
+	 * Zeroed space for count plain values, like calloc
+	 */
+	template<class T>
+	T *makeArray(size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value, "arena arrays are never destroyed");
+		T *array = (T*)allocate(sizeof(T)*count, alignof(T));
+		memset(array, 0, sizeof(T)*count);
+		return array;
+	}
+
+	/**
+	 * Destroy everything made here, newest first, and start handing the same memory out again
+	 */
+	void reset() {
+		while(cleanups) {
+			Cleanup *cleanup = cleanups;
+			cleanups = cleanup->next;
+			cleanup->destroy(cleanup->object);
+		}
+		current = 0;
+		used = 0;
+		bytes = 0;
+		objects = 0;
+		resets++;
+	}
+
+	size_t getBytes() {
+		return bytes;
+	}
+	unsigned int getObjects() {
+		return objects;
+	}
+	/**
+	 * Everything taken from the heap, used or not
+	 */
+	size_t getReserved() {
+		size_t reserved = 0;
+		for(unsigned int i = 0; i < blocks.size(); i++) {
+			reserved += blocks[i].size;
+		}
+		return reserved;
+	}
+
+	void report(std::string name) {
+		printf("%s arena: %u objects in %lu bytes, at most %u objects in %lu bytes, %lu bytes reserved in %u blocks over %u resets\n",
+				name.c_str(), objects, (unsigned long)bytes, peakObjects, (unsigned long)peakBytes,
+				(unsigned long)getReserved(), (unsigned int)blocks.size(), resets);
+	}
+};
+
+#endif
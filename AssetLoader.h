@@ -0,0 +1,86 @@
+//Decodes startup images across every core before the game builds its visuals
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <functional>
+#include "SDL2/SDL.h"
+#include "TextureCache.h"
+#include "JobSystem.h"
+
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+/**
+ * How often the loading screen gets redrawn while workers decode
+ */
+Uint32 const LOADER_PROGRESS_MS = 16;
+
+/**
+ * Collects image paths, then decodes them as jobs across every core.
+ * Jobs only read files and produce pixels; the results are handed to
+ * loadTexture, so the textures themselves still get made on the main thread
+ */
+class AssetLoader {
+	private:
+	std::vector<std::string> paths;
+	std::vector<SDL_Surface*> results;
+	Uint32 format;
+	
+	static void decodeSlice(void *data, int begin, int end) {
+		AssetLoader *loader = (AssetLoader*)data;
+		for(int i = begin; i < end; i++) {
+			loader->results[i] = decodeImage(loader->paths[i], loader->format);
+			if(!loader->results[i])
+				printf("Could not preload '%s': %s\n", loader->paths[i].c_str(), SDL_GetError());
+		}
+	}
+	
+	public:
+	AssetLoader(SDL_Renderer *renderer) {
+		format = nativeFormat(renderer);
+	}
+	
+	/**
+	 * Queue an image, ignoring repeats so no two workers decode the same file
+	 */
+	void add(std::string path) {
+		for(unsigned int i = 0; i < paths.size(); i++) {
+			if(paths.at(i) == path)
+				return;
+		}
+		paths.push_back(path);
+	}
+	
+	/**
+	 * Decode everything queued, calling progress(done, total) on this thread
+	 * until it is finished, then hand the pixels over to loadTexture
+	 */
+	void run(std::function<void(int, int)> progress) {
+		int total = paths.size();
+		results.assign(total, nullptr);
+		JobCounter counter;
+		SDL_AtomicSet(&counter.pending, 0);
+		if(jobSystem)
+			jobSystem->parallelFor(total, 1, decodeSlice, this, &counter);
+		else
+			decodeSlice(this, 0, total);
+		while(SDL_AtomicGet(&counter.pending) > 0) {
+			progress(total - SDL_AtomicGet(&counter.pending), total);
+			//with no worker threads this thread has to do the decoding between redraws
+			if(jobSystem->getThreadCount() > 1 || !jobSystem->help())
+				SDL_Delay(LOADER_PROGRESS_MS);
+		}
+		progress(total, total);
+		
+		for(int i = 0; i < total; i++) {
+			if(!results.at(i))
+				continue;
+			if(preloadedImages.count(paths.at(i)))
+				SDL_FreeSurface(preloadedImages[paths.at(i)]);
+			preloadedImages[paths.at(i)] = results.at(i);
+		}
+		results.clear();
+	}
+};
+
+#endif
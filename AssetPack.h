@@ -0,0 +1,359 @@
+//One file holding every asset, with loaders that fall back to loose files
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+#include "SDL2/SDL_ttf.h"
+#include "SDL2/SDL_mixer.h"
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+/**
+ * Pack layout, all fields native-endian Uint32:
+ *   header:  "OTCP", version, entry count, data alignment
+ *   entries: name offset, name length, data offset, stored size, size, flags
+ *            sorted by name so lookups can binary search
+ *   names:   every path, not null terminated
+ *   data:    each entry starting on a multiple of the alignment
+ */
+std::string const PACK_FILENAME = "Game.pack";
+char const PACK_MAGIC[4] = { 'O', 'T', 'C', 'P' };
+Uint32 const PACK_VERSION = 1;
+Uint32 const PACK_COMPRESSED = 1;
+
+struct PackHeader {
+	char magic[4];
+	Uint32 version;
+	Uint32 count;
+	Uint32 alignment;
+};
+
+struct PackEntry {
+	Uint32 nameOffset;
+	Uint32 nameLength;
+	Uint32 dataOffset;
+	Uint32 storedSize;
+	Uint32 size;
+	Uint32 flags;
+};
+
+/**
+ * Run length encoding, which is plenty for the map files (long runs of empty
+ * tiles) and cheap to undo. A control byte below 128 means that many plus one
+ * literal bytes follow, otherwise the next byte repeats control-125 times
+ */
+std::vector<Uint8> packCompress(Uint8 const *data, Uint32 size) {
+	std::vector<Uint8> out;
+	Uint32 i = 0;
+	while(i < size) {
+		Uint32 run = 1;
+		while(i + run < size && run < 130 && data[i + run] == data[i])
+			run++;
+		if(run >= 3) {
+			out.push_back((Uint8)(run + 125));
+			out.push_back(data[i]);
+			i += run;
+			continue;
+		}
+		//gather literals until the next run worth encoding
+		Uint32 start = i;
+		while(i < size && i - start < 128) {
+			if(i + 2 < size && data[i] == data[i + 1] && data[i] == data[i + 2])
+				break;
+			i++;
+		}
+		out.push_back((Uint8)(i - start - 1));
+		out.insert(out.end(), data + start, data + i);
+	}
+	return out;
+}
+
+bool packDecompress(Uint8 const *data, Uint32 storedSize, Uint8 *out, Uint32 size) {
+	Uint32 in = 0;
+	Uint32 written = 0;
+	while(in < storedSize) {
+		Uint8 control = data[in++];
+		if(control < 128) {
+			Uint32 count = control + 1;
+			if(in + count > storedSize || written + count > size)
+				return false;
+			memcpy(out + written, data + in, count);
+			in += count;
+			written += count;
+		}
+		else {
+			Uint32 count = control - 125;
+			if(in >= storedSize || written + count > size)
+				return false;
+			memset(out + written, data[in++], count);
+			written += count;
+		}
+	}
+	return written == size;
+}
+
+/**
+ * A read-only pack mapped into memory. Compressed entries are expanded the
+ * first time they're opened and kept, swapped in atomically so any thread can read them
+ */
+class AssetPack {
+	private:
+	Uint8 *base;
+	size_t length;
+	PackHeader *header;
+	PackEntry *entries;
+	//null until first opened, only ever set once
+	std::vector<void*> expanded;
+	Sint64 modified;
+	
+	AssetPack() {
+		base = nullptr;
+		length = 0;
+		header = nullptr;
+		entries = nullptr;
+		modified = 0;
+	}
+	
+	void unmap() {
+		if(!base)
+			return;
+#ifndef _WIN32
+		munmap(base, length);
+#else
+		SDL_free(base);
+#endif
+		base = nullptr;
+	}
+	
+	int compareName(Uint32 index, char const *name, size_t nameLength) {
+		PackEntry &entry = entries[index];
+		size_t shorter = entry.nameLength < nameLength ? entry.nameLength : nameLength;
+		int result = memcmp(base + entry.nameOffset, name, shorter);
+		if(result)
+			return result;
+		if(entry.nameLength == nameLength)
+			return 0;
+		return entry.nameLength < nameLength ? -1 : 1;
+	}
+	
+	/**
+	 * A compressed entry's bytes, expanding it if no thread has yet, nullptr if it's corrupt
+	 */
+	Uint8 *expand(int index) {
+		Uint8 *out = (Uint8*)SDL_AtomicGetPtr(&expanded.at(index));
+		if(out)
+			return out;
+		PackEntry &entry = entries[index];
+		out = (Uint8*)malloc(entry.size ? entry.size : 1);
+		if(!out || !packDecompress(base + entry.dataOffset, entry.storedSize, out, entry.size)) {
+			printf("Asset pack entry %d is corrupt\n", index);
+			free(out);
+			return nullptr;
+		}
+		//another thread may have got there first, then theirs is kept
+		if(!SDL_AtomicCASPtr(&expanded.at(index), nullptr, out)) {
+			free(out);
+			out = (Uint8*)SDL_AtomicGetPtr(&expanded.at(index));
+		}
+		return out;
+	}
+	
+	public:
+	~AssetPack() {
+		for(unsigned int i = 0; i < expanded.size(); i++) {
+			free(expanded.at(i));
+		}
+		unmap();
+	}
+	
+	/**
+	 * Map a pack file, or return nullptr if it is missing or broken
+	 */
+	static AssetPack *open(std::string filename) {
+		AssetPack *pack = new AssetPack();
+#ifndef _WIN32
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0) {
+			delete(pack);
+			return nullptr;
+		}
+		struct stat info;
+		if(fstat(fd, &info) == 0 && info.st_size > 0) {
+			void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapped != MAP_FAILED) {
+				pack->base = (Uint8*)mapped;
+				pack->length = info.st_size;
+				//most of the pack gets read while loading anyway, so ask for it in one sweep
+				madvise(mapped, info.st_size, MADV_WILLNEED);
+			}
+		}
+		close(fd);
+#else
+		pack->base = (Uint8*)SDL_LoadFile(filename.c_str(), &pack->length);
+#endif
+		struct stat packInfo;
+		if(stat(filename.c_str(), &packInfo) == 0)
+			pack->modified = packInfo.st_mtime;
+		if(!pack->base || pack->length < sizeof(PackHeader)) {
+			delete(pack);
+			return nullptr;
+		}
+		pack->header = (PackHeader*)pack->base;
+		pack->entries = (PackEntry*)(pack->base + sizeof(PackHeader));
+		if(memcmp(pack->header->magic, PACK_MAGIC, 4) || pack->header->version != PACK_VERSION
+		|| sizeof(PackHeader) + (size_t)pack->header->count*sizeof(PackEntry) > pack->length) {
+			printf("'%s' is not a valid asset pack\n", filename.c_str());
+			delete(pack);
+			return nullptr;
+		}
+		pack->expanded.assign(pack->header->count, nullptr);
+		for(Uint32 i = 0; i < pack->header->count; i++) {
+			PackEntry &entry = pack->entries[i];
+			if((size_t)entry.nameOffset + entry.nameLength > pack->length || (size_t)entry.dataOffset + entry.storedSize > pack->length) {
+				printf("'%s' is truncated\n", filename.c_str());
+				delete(pack);
+				return nullptr;
+			}
+		}
+		return pack;
+	}
+	
+	/**
+	 * Binary search the sorted index, -1 if the path isn't packed
+	 */
+	int find(std::string const &path) {
+		int low = 0;
+		int high = (int)header->count - 1;
+		while(low <= high) {
+			int mid = (low + high) / 2;
+			int result = compareName(mid, path.c_str(), path.length());
+			if(result == 0)
+				return mid;
+			if(result < 0)
+				low = mid + 1;
+			else
+				high = mid - 1;
+		}
+		return -1;
+	}
+	
+	/**
+	 * A read-only stream over a packed file, or nullptr if it isn't packed
+	 */
+	SDL_RWops *openRW(std::string const &path) {
+		int index = find(path);
+		if(index < 0)
+			return nullptr;
+		PackEntry &entry = entries[index];
+		if(entry.flags & PACK_COMPRESSED) {
+			//a corrupt entry falls back to the loose file
+			Uint8 *out = expand(index);
+			return out ? SDL_RWFromConstMem(out, entry.size) : nullptr;
+		}
+		return SDL_RWFromConstMem(base + entry.dataOffset, entry.size);
+	}
+	
+	/**
+	 * Packed files all change when the pack is rebuilt, so they share its modification time
+	 */
+	bool stamp(std::string const &path, Sint64 *modified, Uint64 *size) {
+		int index = find(path);
+		if(index < 0)
+			return false;
+		*modified = this->modified;
+		*size = entries[index].size;
+		return true;
+	}
+	
+	int size() {
+		return header->count;
+	}
+};
+
+/**
+ * The pack the game is running from, if there is one
+ */
+static AssetPack *assetPack = nullptr;
+
+/**
+ * Open an asset from the pack, or from disk if it isn't packed
+ */
+SDL_RWops *openAsset(std::string const &path) {
+	if(assetPack) {
+		SDL_RWops *rw = assetPack->openRW(path);
+		if(rw)
+			return rw;
+	}
+	return SDL_RWFromFile(path.c_str(), "rb");
+}
+
+/**
+ * When an asset last changed and how big it is, for anything caching what was made from it
+ */
+bool assetStamp(std::string const &path, Sint64 *modified, Uint64 *size) {
+	if(assetPack && assetPack->stamp(path, modified, size))
+		return true;
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0)
+		return false;
+	*modified = info.st_mtime;
+	*size = info.st_size;
+	return true;
+}
+
+SDL_Surface *loadImage(std::string path) {
+	SDL_RWops *rw = openAsset(path);
+	return rw ? IMG_Load_RW(rw, 1) : nullptr;
+}
+
+TTF_Font *loadFont(std::string path, int size) {
+	SDL_RWops *rw = openAsset(path);
+	return rw ? TTF_OpenFontRW(rw, 1, size) : nullptr;
+}
+
+Mix_Music *loadMusic(std::string path) {
+	SDL_RWops *rw = openAsset(path);
+	return rw ? Mix_LoadMUS_RW(rw, 1) : nullptr;
+}
+
+Mix_Chunk *loadSound(std::string path) {
+	SDL_RWops *rw = openAsset(path);
+	return rw ? Mix_LoadWAV_RW(rw, 1) : nullptr;
+}
+
+/**
+ * Read a whole asset into a null terminated buffer, free it with SDL_free
+ */
+char *loadText(std::string path) {
+	SDL_RWops *rw = openAsset(path);
+	return rw ? (char*)SDL_LoadFile_RW(rw, NULL, 1) : nullptr;
+}
+
+/**
+ * Split a loaded text buffer in place, returning the next line and moving past it
+ */
+char *nextLine(char **cursor) {
+	char *line = *cursor;
+	if(!line || !*line)
+		return nullptr;
+	char *end = strchr(line, '\n');
+	if(end) {
+		*end = '\0';
+		*cursor = end + 1;
+	}
+	else {
+		*cursor = line + strlen(line);
+	}
+	return line;
+}
+
+#endif
@@ -0,0 +1,291 @@
+//Music and sound playback
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_mixer.h"
+#include "AssetPack.h"
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+/**
+ * How many opened songs to keep around, and how long to fade between them
+ */
+int const MUSIC_CACHE_SIZE = 3;
+int const MUSIC_FADE_MS = 500;
+
+/**
+ * Mixer channels reserved for sound effects
+ */
+int const SOUND_CHANNELS = 8;
+
+/**
+ * Plays one song at a time. Songs are opened on a loader thread and kept in a
+ * small cache, so switching back and forth between level tracks doesn't touch
+ * the disk on the main thread. The old song fades out while the new one loads
+ */
+class MusicHandler {
+	private:
+	struct CachedSong {
+		std::string name;
+		Mix_Music *music;
+		bool ready;
+		unsigned int lastUsed;
+	};
+	//only touched by the main thread
+	std::vector<CachedSong> cache;
+	std::string currentSong;
+	std::string pendingSong;
+	//the one SDL_mixer has, which goes on fading out after currentSong changes.
+	//Freeing music that's still fading waits for the fade, so it's never evicted
+	std::string playingSong;
+	unsigned int useCounter;
+	//shared with the loader thread, guarded by lock
+	SDL_Thread *loader;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	std::vector<std::string> requests;
+	std::vector<CachedSong> loaded;
+	bool quitting;
+	
+	static int loaderMain(void *data) {
+		((MusicHandler*)data)->loaderLoop();
+		return 0;
+	}
+	
+	void loaderLoop() {
+		SDL_LockMutex(lock);
+		while(!quitting) {
+			if(requests.empty()) {
+				SDL_CondWait(wake, lock);
+				continue;
+			}
+			std::string name = requests.front();
+			requests.erase(requests.begin());
+			SDL_UnlockMutex(lock);
+			
+			CachedSong song = { name, loadMusic(name), true, 0 };
+			if(!song.music) {
+				printf("Mix_LoadMUS: %s\n", Mix_GetError());
+			}
+			
+			SDL_LockMutex(lock);
+			loaded.push_back(song);
+		}
+		SDL_UnlockMutex(lock);
+	}
+	
+	CachedSong *find(std::string const &name) {
+		for(unsigned int i = 0; i < cache.size(); i++) {
+			if(cache.at(i).name == name)
+				return &cache.at(i);
+		}
+		return nullptr;
+	}
+	
+	/**
+	 * Free the least recently used songs until the cache fits, never the one playing or about to
+	 */
+	void evict() {
+		while(cache.size() > (unsigned int)MUSIC_CACHE_SIZE) {
+			int oldest = -1;
+			for(unsigned int i = 0; i < cache.size(); i++) {
+				CachedSong &song = cache.at(i);
+				if(!song.ready || song.name == currentSong || song.name == pendingSong)
+					continue;
+				if(song.name == playingSong && Mix_PlayingMusic())
+					continue;
+				if(oldest < 0 || song.lastUsed < cache.at(oldest).lastUsed)
+					oldest = i;
+			}
+			if(oldest < 0)
+				return;
+			if(cache.at(oldest).music) Mix_FreeMusic(cache.at(oldest).music);
+			cache.erase(cache.begin() + oldest);
+		}
+	}
+	
+	public:
+	MusicHandler() {
+		useCounter = 0;
+		quitting = false;
+		lock = SDL_CreateMutex();
+		wake = SDL_CreateCond();
+		loader = SDL_CreateThread(loaderMain, "MusicLoader", this);
+	}
+	~MusicHandler() {
+		SDL_LockMutex(lock);
+		quitting = true;
+		SDL_CondSignal(wake);
+		SDL_UnlockMutex(lock);
+		SDL_WaitThread(loader, NULL);
+		stop();
+		for(unsigned int i = 0; i < loaded.size(); i++) {
+			if(loaded.at(i).music) Mix_FreeMusic(loaded.at(i).music);
+		}
+		for(unsigned int i = 0; i < cache.size(); i++) {
+			if(cache.at(i).music) Mix_FreeMusic(cache.at(i).music);
+		}
+		SDL_DestroyCond(wake);
+		SDL_DestroyMutex(lock);
+	}
+	
+	void play(std::string const &arg) {
+		//printf("Try to play song %s\n",arg.c_str());
+		if(currentSong == arg)
+			return;
+		currentSong = arg;
+		pendingSong = arg;
+		prefetch(arg);
+		//fade out whatever is playing while the next one gets ready
+		if(Mix_PlayingMusic())
+			Mix_FadeOutMusic(MUSIC_FADE_MS);
+	}
+	
+	/**
+	 * Start loading a song that is about to be needed, without playing it
+	 */
+	void prefetch(std::string const &arg) {
+		if(find(arg))
+			return;
+		CachedSong song = { arg, nullptr, false, 0 };
+		cache.push_back(song);
+		SDL_LockMutex(lock);
+		requests.push_back(arg);
+		SDL_CondSignal(wake);
+		SDL_UnlockMutex(lock);
+	}
+	
+	/**
+	 * Pick up finished loads and start the pending song once the old one has faded out
+	 */
+	void update() {
+		SDL_LockMutex(lock);
+		for(unsigned int i = 0; i < loaded.size(); i++) {
+			CachedSong *song = find(loaded.at(i).name);
+			if(song) {
+				song->music = loaded.at(i).music;
+				song->ready = true;
+			}
+			else if(loaded.at(i).music) {
+				Mix_FreeMusic(loaded.at(i).music);
+			}
+		}
+		loaded.clear();
+		SDL_UnlockMutex(lock);
+		
+		if(pendingSong != "" && !Mix_PlayingMusic()) {
+			CachedSong *song = find(pendingSong);
+			if(song && song->ready) {
+				song->lastUsed = ++useCounter;
+				playingSong = pendingSong;
+				pendingSong = "";
+				if(song->music && Mix_FadeInMusic(song->music, -1, MUSIC_FADE_MS) == -1) {
+					printf("Mix_FadeInMusic: %s\n", Mix_GetError());
+				}
+			}
+		}
+		evict();
+	}
+	
+	void stop() {
+		Mix_HaltMusic();
+		currentSong = "";
+		pendingSong = "";
+		playingSong = "";
+	}
+};
+
+/**
+ * Every sound effect, decoded into memory up front so playing one never touches
+ * the disk or allocates. When all channels are busy a new sound takes over the
+ * channel playing the lowest priority sound, if that is lower than its own
+ */
+class SoundBank {
+	private:
+	struct SoundEffect {
+		std::string name;
+		Mix_Chunk *chunk;
+		int priority;
+	};
+	std::vector<SoundEffect> sounds;
+	//priority of whatever each channel last started playing
+	std::vector<int> channelPriority;
+	
+	public:
+	/**
+	 * Load the list file, one sound per line: <name> <file> <priority> <volume 0-128>
+	 */
+	SoundBank(std::string filename, int channels) {
+		Mix_AllocateChannels(channels);
+		channelPriority.assign(channels, 0);
+		char *text = loadText(filename);
+		if(!text) {
+			printf("Could not open sound list '%s'\n", filename.c_str());
+			return;
+		}
+		char *cursor = text;
+		char *line;
+		while((line = nextLine(&cursor))) {
+			char name[64] = { 0 };
+			char file[256] = { 0 };
+			int priority = 0;
+			int volume = MIX_MAX_VOLUME;
+			if(line[0] == '#' || sscanf(line, "%63s %255s %d %d", name, file, &priority, &volume) < 2)
+				continue;
+			SoundEffect sound = { name, loadSound(file), priority };
+			if(!sound.chunk) {
+				//keep the slot so ids stay stable, it just won't play
+				printf("Mix_LoadWAV: %s\n", Mix_GetError());
+			}
+			else {
+				Mix_VolumeChunk(sound.chunk, volume);
+			}
+			sounds.push_back(sound);
+		}
+		SDL_free(text);
+	}
+	~SoundBank() {
+		for(unsigned int i = 0; i < channelPriority.size(); i++) {
+			Mix_HaltChannel(i);
+		}
+		for(unsigned int i = 0; i < sounds.size(); i++) {
+			if(sounds.at(i).chunk) Mix_FreeChunk(sounds.at(i).chunk);
+		}
+	}
+	
+	/**
+	 * Look up a sound's id once so playing it later is just an index
+	 */
+	int find(std::string const &name) {
+		for(unsigned int i = 0; i < sounds.size(); i++) {
+			if(sounds.at(i).name == name)
+				return i;
+		}
+		return -1;
+	}
+	
+	void play(int id) {
+		if(id < 0 || id >= (int)sounds.size() || !sounds[id].chunk)
+			return;
+		int priority = sounds[id].priority;
+		//first free channel, otherwise the lowest priority one below ours
+		int channel = -1;
+		for(unsigned int i = 0; i < channelPriority.size(); i++) {
+			if(!Mix_Playing(i)) {
+				channel = i;
+				break;
+			}
+			if(channelPriority[i] < priority && (channel < 0 || channelPriority[i] < channelPriority[channel]))
+				channel = i;
+		}
+		if(channel < 0)
+			return;
+		Mix_HaltChannel(channel);
+		if(Mix_PlayChannel(channel, sounds[id].chunk, 0) != -1)
+			channelPriority[channel] = priority;
+	}
+};
+
+#endif
@@ -0,0 +1,776 @@
+//Microbenchmarks for the engine's hot paths, run against the real maps and levels
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+#include "SDL2/SDL_ttf.h"
+#include "SDL2/SDL_mixer.h"
+#include "GameData.h"
+#include "PlayerLogic.h"
+#include "GameObject.h"
+#include "LevelManifest.h"
+#include "FloodFill.h"
+#include "Allocations.h"
+
+/**
+ * Untimed runs to warm caches up, and timed runs to take the spread of
+ */
+int const WARMUP_RUNS = 2;
+int const TIMED_RUNS = 9;
+
+/**
+ * Tile sizes to measure at, the tileset's own, the player's reference and the game's
+ */
+int const TILE_SIZE_COUNT = 4;
+int const TILE_SIZES[TILE_SIZE_COUNT] = { 16, 32, 48, 64 };
+
+/**
+ * Work per run for each kind of benchmark
+ */
+int const READ_REPEATS = 20;
+int const PROBE_COUNT = 1000000;
+int const COLLIDER_STEPS = 20000;
+//ticks between putting the player somewhere new, so falls and runs get going
+int const COLLIDER_DROP_EVERY = 60;
+int const QUEUE_COMMANDS = 16384;
+int const ENTITY_TICKS = 120;
+int const DRAW_FRAMES = 120;
+int const DRAW_WIDTH = 1280;
+int const DRAW_HEIGHT = 720;
+
+/**
+ * A made up level where every tile is animated, written out for the run and
+ * removed after. Tiles on the tileset's first two rows swap with the tile
+ * above or below them, at a few different rates so chunks only partly change
+ */
+std::string const ANIMATED_MAP = "Data/bench.map";
+std::string const ANIMATED_LIST = "Data/bench.anim";
+int const ANIMATED_W = 64;
+int const ANIMATED_H = 48;
+int const ANIMATED_COLUMNS = 13;
+//milliseconds of animation each drawn frame moves on by
+Uint32 const DRAW_FRAME_MS = 16;
+
+/**
+ * A function to time and what it works on. Each run does ops operations and
+ * returns a checksum of what it found, so the work can't be skipped and any
+ * change in behaviour shows up next to the timings
+ */
+struct Benchmark {
+	std::string name;
+	std::string params;
+	int ops;
+	Uint64 (*run)(void *data);
+	void *data;
+};
+
+/**
+ * The same scattered point for the same index every run
+ */
+void scatter(int i, int width, int height, int *x, int *y) {
+	Uint32 seed = (Uint32)i*2654435761u;
+	seed ^= seed >> 15;
+	*x = seed % width;
+	seed = seed*2246822519u + 1;
+	*y = (seed >> 8) % height;
+}
+
+struct ReadJob {
+	std::string filename;
+};
+
+Uint64 readMap(void *data) {
+	ReadJob *job = (ReadJob*)data;
+	Uint64 total = 0;
+	for(int i = 0; i < READ_REPEATS; i++) {
+		MapData *map = readFile(job->filename);
+		total += map->getW()*map->getH() + map->getData()[0][0];
+		delete(map);
+	}
+	return total;
+}
+
+struct ProbeJob {
+	MapData *map;
+	int tileSize;
+};
+
+Uint64 probeMap(void *data) {
+	ProbeJob *job = (ProbeJob*)data;
+	int width = job->map->getW()*job->tileSize;
+	int height = job->map->getH()*job->tileSize;
+	Uint64 solid = 0;
+	for(int i = 0; i < PROBE_COUNT; i++) {
+		int x;
+		int y;
+		scatter(i, width, height, &x, &y);
+		solid += job->map->valueAtPoint(x, y, job->tileSize) != -1;
+	}
+	return solid;
+}
+
+/**
+ * What the player is doing each time it's put down
+ */
+int const COLLIDER_SCENARIOS = 5;
+std::string const COLLIDER_SCENARIO_NAMES[COLLIDER_SCENARIOS] = { "idle", "run", "slide", "jump", "fall" };
+
+struct ColliderJob {
+	Player *player;
+	MapData *map;
+	int tileSize;
+	int scenario;
+};
+
+Uint64 moveCollider(void *data) {
+	ColliderJob *job = (ColliderJob*)data;
+	auto collider = job->player->getCollision();
+	int width = job->map->getW()*job->tileSize;
+	int height = job->map->getH()*job->tileSize;
+	Uint64 total = 0;
+	for(int i = 0; i < COLLIDER_STEPS; i++) {
+		if(i%COLLIDER_DROP_EVERY == 0) {
+			int x;
+			int y;
+			scatter(i/COLLIDER_DROP_EVERY, width, height, &x, &y);
+			job->player->setState(PLAYER_STANDING);
+			job->player->changeMap(job->map, x, y);
+			collider->stop();
+			collider->clearYVel();
+			collider->setGravity(job->scenario != 0);
+			if(job->scenario == 1 || job->scenario == 3)
+				collider->move(1);
+			else if(job->scenario == 2)
+				collider->slide(0);
+			if(job->scenario == 3)
+				collider->jump();
+		}
+		collider->update(SIM_TICK_MS);
+		SDL_Rect rect = collider->getRect();
+		total += rect.x + rect.y;
+	}
+	return total;
+}
+
+/**
+ * Synthetic maps to fill, an open room or one long path winding back and forth
+ */
+int const FILL_OPEN = 0;
+int const FILL_WINDING = 1;
+
+struct FillJob {
+	MapData *map;
+	//fills alternate between two values so the map never needs resetting
+	int value;
+};
+
+MapData *fillMap(int size, int layout) {
+	MapData *map = new MapData(size, size);
+	int **data = map->getData();
+	for(int y = 0; y < size; y++) {
+		for(int x = 0; x < size; x++) {
+			//every other row is a wall with a gap at alternating ends
+			bool wall = layout == FILL_WINDING && y%2 == 1 && x != (y%4 == 1 ? size - 1 : 0);
+			data[y][x] = wall ? 1 : -1;
+		}
+	}
+	return map;
+}
+
+Uint64 fill(void *data) {
+	FillJob *job = (FillJob*)data;
+	job->value = job->value == 2 ? -1 : 2;
+	floodFill(job->map->getData(), job->map->getW(), job->map->getH(), 0, 0, job->value);
+	Uint64 filled = 0;
+	for(int y = 0; y < job->map->getH(); y++) {
+		for(int x = 0; x < job->map->getW(); x++) {
+			filled += job->map->getData()[y][x] == job->value;
+		}
+	}
+	return filled;
+}
+
+struct EntityJob {
+	EntityStore *store;
+	MapData *map;
+	int tileSize;
+	int count;
+};
+
+/**
+ * Entities scattered over a map, a mix of every kind moving every which way
+ */
+void spawnEntities(EntityJob *job) {
+	job->store->clear();
+	job->store->reserve(job->count);
+	for(int i = 0; i < job->count; i++) {
+		int x;
+		int y;
+		scatter(i, job->map->getW(), job->map->getH(), &x, &y);
+		EntitySpawn spawn = { i%ENTITY_KINDS, 10, (float)x, (float)y, 1, 1, (float)(i%7) - 3, (float)(i%5) - 2, (float)(i%4) };
+		job->store->spawn(spawn, job->tileSize);
+	}
+}
+
+Uint64 stepEntities(void *data) {
+	EntityJob *job = (EntityJob*)data;
+	spawnEntities(job);
+	for(int i = 0; i < ENTITY_TICKS; i++) {
+		job->store->update(SIM_TICK_MS/1000.0f, job->map, job->tileSize);
+	}
+	Uint64 total = 0;
+	for(int i = 0; i < job->store->size(); i++) {
+		SDL_Rect rect = job->store->getRect(i);
+		total += rect.x + rect.y;
+	}
+	return total;
+}
+
+struct QueueJob {
+	CommandQueue *queue;
+	//commands let build up before they're taken off
+	int depth;
+};
+
+Uint64 queueCommands(void *data) {
+	QueueJob *job = (QueueJob*)data;
+	std::string const play = "play Assets/Sound/Interlude.ogg";
+	std::string command;
+	Uint64 total = 0;
+	for(int i = 0; i < QUEUE_COMMANDS; i += job->depth) {
+		for(int j = 0; j < job->depth; j++) {
+			job->queue->add(play);
+		}
+		while(job->queue->remove(command)) {
+			total += command.size();
+		}
+	}
+	return total;
+}
+
+struct WorldJob {
+	std::string name;
+	WorldMap *world;
+	//every tile read at once, what the streamed window has to agree with
+	MapData *whole;
+	int tileSize;
+	//stream on the job system the way the renderer does, instead of the way the simulation does
+	bool ahead;
+	int mismatches;
+};
+
+/**
+ * Every tile of a world in one map, chunk by chunk
+ */
+MapData *readWholeWorld(WorldMap *world) {
+	int chunksX = (world->getW() + CHUNK_TILES - 1)/CHUNK_TILES;
+	int chunksY = (world->getH() + CHUNK_TILES - 1)/CHUNK_TILES;
+	MapData *whole = new MapData(chunksX*CHUNK_TILES, chunksY*CHUNK_TILES);
+	for(int cy = 0; cy < chunksY; cy++) {
+		for(int cx = 0; cx < chunksX; cx++) {
+			world->readChunk(cx, cy, whole, cx*CHUNK_TILES, cy*CHUNK_TILES);
+		}
+	}
+	return whole;
+}
+
+/**
+ * Steps in a walk over a world, a tile each: along the middle row and back, then down the middle column and back
+ */
+int worldSteps(WorldMap *world) {
+	return 2*(world->getW() + world->getH());
+}
+
+void worldWalk(WorldMap *world, int i, int *x, int *y) {
+	int w = world->getW();
+	int h = world->getH();
+	*x = w/2;
+	*y = h/2;
+	if(i < 2*w)
+		*x = i < w ? i : 2*w - 1 - i;
+	else
+		*y = i - 2*w < h ? i - 2*w : 2*h - 1 - (i - 2*w);
+}
+
+/**
+ * Count a mismatch if the window has tile x, y and it isn't what the world has there
+ */
+int compareTile(MapData *window, MapData *whole, int x, int y) {
+	int wx = x - window->getOriginX();
+	int wy = y - window->getOriginY();
+	if(wx < 0 || wy < 0 || wx >= window->getW() || wy >= window->getH())
+		return 0;
+	int expected = x >= 0 && y >= 0 && x < whole->getW() && y < whole->getH() ? whole->getData()[y][x] : -1;
+	return window->getData()[wy][wx] != expected;
+}
+
+/**
+ * Walk a streamer across every chunk border of a world both ways, checking
+ * the walker's row and column of the window against the whole world as it goes
+ */
+Uint64 streamWorld(void *data) {
+	WorldJob *job = (WorldJob*)data;
+	WorldStreamer *streamer = new WorldStreamer(job->world);
+	MapData *window = streamer->getMap();
+	Uint64 total = 0;
+	for(int i = 0; i < worldSteps(job->world); i++) {
+		int x;
+		int y;
+		worldWalk(job->world, i, &x, &y);
+		int wx;
+		int wy;
+		bool covered;
+		do {
+			if(job->ahead)
+				streamer->followAhead(x*job->tileSize + job->tileSize/2, y*job->tileSize + job->tileSize/2, job->tileSize);
+			else
+				streamer->follow(x*job->tileSize + job->tileSize/2, y*job->tileSize + job->tileSize/2, job->tileSize);
+			wx = x - window->getOriginX();
+			wy = y - window->getOriginY();
+			covered = wx >= 0 && wy >= 0 && wx < window->getW() && wy < window->getH();
+			//a tile a step is far faster than anyone plays, so reading ahead can fall behind.
+			//The game would draw a frame without those tiles, here it waits for them
+			if(!covered && job->ahead)
+				SDL_Delay(0);
+		} while(!covered && job->ahead);
+		if(!covered) {
+			job->mismatches++;
+			continue;
+		}
+		for(int d = -CHUNK_TILES; d <= CHUNK_TILES; d++) {
+			job->mismatches += compareTile(window, job->whole, x + d, y) + compareTile(window, job->whole, x, y + d);
+		}
+		total += window->getData()[wy][wx] + 1;
+	}
+	delete(streamer);
+	return total;
+}
+
+struct DrawJob {
+	SDL_Renderer *renderer;
+	SDL_Surface *surface;
+	//levels cost a background texture each, so they're only made while being run
+	int id;
+	LevelEntry const *entry;
+	TileAnimations *animations;
+	//move the animations on every frame
+	bool animate;
+	GameLevel *level;
+	Player *player;
+	//throw the layer caches away every frame, to time building them
+	bool cold;
+	//draw the back of the level on the CPU instead, as the game does without a GPU
+	SoftwareCanvas *canvas;
+};
+
+/**
+ * Pan across the level the way the renderer would follow the player, checksumming the middle pixel
+ */
+Uint64 drawLevel(void *data) {
+	DrawJob *job = (DrawJob*)data;
+	GameSnapshot frame;
+	frame.tick = 0;
+	frame.level = job->level->getId();
+	frame.player = job->player->getRect();
+	frame.clip = job->player->getClip();
+	frame.stateTicks = 0;
+	frame.rightFacing = true;
+	job->level->getEntities()->capture(frame.entityRects, frame.entitySprites);
+	int width = job->level->getW()*job->level->getTileSize();
+	Uint32 *pixels = (Uint32*)job->surface->pixels;
+	Uint64 total = 0;
+	for(int i = 0; i < DRAW_FRAMES; i++) {
+		frame.player.x = (Sint64)width*i/DRAW_FRAMES;
+		job->level->camera(frame.player, DRAW_WIDTH, DRAW_HEIGHT, &frame.offX, &frame.offY);
+		if(job->animate)
+			job->animations->update(i*DRAW_FRAME_MS);
+		if(job->cold)
+			job->level->invalidate();
+		job->level->prepare(frame, DRAW_WIDTH, DRAW_HEIGHT);
+		job->level->draw(frame, job->player, DRAW_WIDTH, DRAW_HEIGHT);
+		SDL_RenderPresent(job->renderer);
+		total += pixels[DRAW_HEIGHT/2*job->surface->pitch/4 + DRAW_WIDTH/2];
+	}
+	return total;
+}
+
+/**
+ * Write out the animated level's map and animation list
+ */
+bool writeAnimatedLevel() {
+	std::ofstream map(ANIMATED_MAP, std::ios::binary);
+	std::ofstream list(ANIMATED_LIST);
+	if(!map || !list)
+		return false;
+	int const size[2] = { ANIMATED_W, ANIMATED_H };
+	map.write((char const*)size, sizeof(size));
+	for(int y = 0; y < ANIMATED_H; y++) {
+		for(int x = 0; x < ANIMATED_W; x++) {
+			int tile = (x + 3*y) % (2*ANIMATED_COLUMNS);
+			map.write((char const*)&tile, sizeof(tile));
+		}
+	}
+	for(int tile = 0; tile < 2*ANIMATED_COLUMNS; tile++) {
+		list << tile << " " << 50*(1 + tile%4) << " " << tile << " " << (tile + ANIMATED_COLUMNS) % (2*ANIMATED_COLUMNS) << "\n";
+	}
+	return map.good() && list.good();
+}
+
+/**
+ * Draw the animated level with its chunks kept, and again from scratch, every
+ * frame of a pan. Returns how many frames came out different, which would mean
+ * redrawing just the cells that changed left a cached chunk wrong
+ */
+int checkAnimatedDraw(SDL_Renderer *renderer, SDL_Surface *surface, Arena *arena, LevelEntry const &entry, TileAnimations *animations, Player *player) {
+	GameLevel *cached = arena->make<GameLevel>(arena, renderer, 0, entry, TILESET, TILE_SIZES[2], animations);
+	GameLevel *cold = arena->make<GameLevel>(arena, renderer, 0, entry, TILESET, TILE_SIZES[2], animations);
+	player->changeTileSize(TILE_SIZES[2]);
+	cold->load(player, 0);
+	cached->load(player, 0);
+	GameSnapshot frame;
+	frame.tick = 0;
+	frame.level = 0;
+	frame.player = player->getRect();
+	frame.clip = player->getClip();
+	frame.stateTicks = 0;
+	frame.rightFacing = true;
+	int width = cached->getW()*cached->getTileSize();
+	std::vector<Uint32> expected((size_t)surface->h*surface->pitch/4);
+	int different = 0;
+	for(int i = 0; i < DRAW_FRAMES; i++) {
+		frame.player.x = (Sint64)width*i/DRAW_FRAMES;
+		cached->camera(frame.player, DRAW_WIDTH, DRAW_HEIGHT, &frame.offX, &frame.offY);
+		animations->update(i*DRAW_FRAME_MS);
+		cold->invalidate();
+		cold->prepare(frame, DRAW_WIDTH, DRAW_HEIGHT);
+		cold->draw(frame, player, DRAW_WIDTH, DRAW_HEIGHT);
+		SDL_RenderPresent(renderer);
+		memcpy(&expected[0], surface->pixels, expected.size()*sizeof(Uint32));
+		cached->prepare(frame, DRAW_WIDTH, DRAW_HEIGHT);
+		cached->draw(frame, player, DRAW_WIDTH, DRAW_HEIGHT);
+		SDL_RenderPresent(renderer);
+		different += memcmp(&expected[0], surface->pixels, expected.size()*sizeof(Uint32)) != 0;
+	}
+	arena->reset();
+	return different;
+}
+
+/**
+ * Time a benchmark and print its row, in nanoseconds per operation
+ */
+void measure(Benchmark const &bench, int runs) {
+	Uint64 checksum = 0;
+	for(int i = 0; i < WARMUP_RUNS; i++) {
+		checksum = bench.run(bench.data);
+	}
+	std::vector<double> times;
+	for(int i = 0; i < runs; i++) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		checksum = bench.run(bench.data);
+		times.push_back((SDL_GetPerformanceCounter() - start)*1e9/SDL_GetPerformanceFrequency()/bench.ops);
+	}
+	std::sort(times.begin(), times.end());
+	printf("%s,%s,%d,%d,%.1f,%.1f,%.1f,%llu\n", bench.name.c_str(), bench.params.c_str(), bench.ops, runs,
+			times.front(), times[times.size()/2], times.back(), (unsigned long long)checksum);
+	fflush(stdout);
+}
+
+#ifdef TRACK_ALLOCATIONS
+/**
+ * Frames of play to settle in over, then to count allocations in, which should come to none
+ */
+int const STEADY_WARMUP_FRAMES = 120;
+int const STEADY_FRAMES = 300;
+//frames between turning around and between jumps, so the player stays near where they started
+int const STEADY_TURN_FRAMES = 30;
+int const STEADY_JUMP_FRAMES = 45;
+
+SDL_Event keyEvent(Uint32 type, SDL_Keycode key) {
+	SDL_Event event;
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.key.timestamp = SDL_GetTicks();
+	event.key.keysym.sym = key;
+	return event;
+}
+
+/**
+ * Play the first level the way the window does, running back and forth and
+ * jumping, and count what's allocated once it has settled in
+ */
+Uint64 steadyAllocations(SDL_Renderer *renderer, LevelManifest *manifest) {
+	CommandQueue *queue = new CommandQueue();
+	InputQueue *input = new InputQueue();
+	LevelState *levelState = new LevelState("Data/bench.sav");
+	GameObject *object = new GameObject(renderer, queue, input, levelState, manifest, nullptr, TILE_SIZES[2], DRAW_WIDTH, DRAW_HEIGHT);
+	std::string command;
+	command.reserve(COMMAND_RESERVE);
+	FrameAllocations allocations;
+	queue->add(object->onActive());
+	for(int i = 0; i < STEADY_WARMUP_FRAMES + STEADY_FRAMES; i++) {
+		allocations.begin();
+		//hold one way, then the other
+		if(i%STEADY_TURN_FRAMES == 0) {
+			bool right = i/STEADY_TURN_FRAMES%2 == 0;
+			object->handleInput(keyEvent(SDL_KEYUP, right ? SDLK_a : SDLK_d));
+			object->handleInput(keyEvent(SDL_KEYDOWN, right ? SDLK_d : SDLK_a));
+		}
+		if(i%STEADY_JUMP_FRAMES == 0)
+			object->handleInput(keyEvent(SDL_KEYDOWN, SDLK_SPACE));
+		//nothing plays the music here, so commands are just taken off
+		while(queue->remove(command)) {
+		}
+		SDL_RenderClear(renderer);
+		object->draw();
+		SDL_RenderPresent(renderer);
+		input->presented(object->getShownTick());
+		SDL_Delay(1000/SIM_TICKS_PER_SECOND);
+		allocations.end(i >= STEADY_WARMUP_FRAMES);
+	}
+	object->onInactive();
+	allocations.report("Steady play");
+	Uint64 total = allocations.getTotal();
+	delete(object);
+	levelState->deleteSave();
+	delete(levelState);
+	delete(input);
+	delete(queue);
+	return total;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+	std::string filter = argc > 1 ? argv[1] : "";
+	int runs = argc > 2 ? atoi(argv[2]) : TIMED_RUNS;
+	runs = runs > 0 ? runs : 1;
+
+	//draw in memory, no window or GPU needed
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+	if(SDL_Init(SDL_INIT_VIDEO) < 0 || !(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+		printf("Couldn't start SDL: %s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, DRAW_WIDTH, DRAW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+	if(!renderer) {
+		printf("Couldn't make a software renderer: %s\n", SDL_GetError());
+		exit(EXIT_FAILURE);
+	}
+	if(SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND) < 0) {
+		printf("%s\n", SDL_GetError());
+	}
+
+	LevelManifest *manifest = new LevelManifest(LEVEL_MANIFEST);
+	Player *player = new Player(renderer, 0, 0, nullptr, TILE_SIZES[0]);
+	std::vector<MapData*> maps;
+	std::vector<Benchmark> benches;
+
+	std::vector<ReadJob> reads;
+	std::vector<ProbeJob> probes;
+	std::vector<ColliderJob> colliders;
+	std::vector<FillJob> fills;
+	std::vector<QueueJob> queues;
+	std::vector<EntityJob> entityJobs;
+	std::vector<WorldJob> worldJobs;
+	std::vector<DrawJob> draws;
+	//jobs are pointed to by their benchmarks, so nothing can be added to these after
+	reads.reserve(manifest->getCount());
+	probes.reserve(manifest->getCount()*TILE_SIZE_COUNT);
+	colliders.reserve(TILE_SIZE_COUNT*COLLIDER_SCENARIOS);
+	fills.reserve(6);
+	queues.reserve(3);
+	entityJobs.reserve(2);
+	worldJobs.reserve(manifest->getCount()*2);
+	draws.reserve(manifest->getCount()*3);
+
+	//every map in the manifest that isn't a streamed world
+	std::vector<std::string> names;
+	for(int i = 0; i < manifest->getCount(); i++) {
+		LevelEntry const &entry = manifest->get(i);
+		if(entry.places.empty() && std::find(names.begin(), names.end(), entry.map) == names.end())
+			names.push_back(entry.map);
+	}
+	for(unsigned int i = 0; i < names.size(); i++) {
+		std::string name = names[i].substr(names[i].rfind('/') + 1);
+		reads.push_back({ names[i] });
+		benches.push_back({ "readFile", name, READ_REPEATS, readMap, &reads.back() });
+		maps.push_back(readFile(names[i]));
+		for(int j = 0; j < TILE_SIZE_COUNT; j++) {
+			probes.push_back({ maps.back(), TILE_SIZES[j] });
+			benches.push_back({ "valueAtPoint", name + " tile=" + std::to_string(TILE_SIZES[j]), PROBE_COUNT, probeMap, &probes.back() });
+		}
+	}
+
+	for(int i = 0; !maps.empty() && i < TILE_SIZE_COUNT; i++) {
+		for(int j = 0; j < COLLIDER_SCENARIOS; j++) {
+			colliders.push_back({ player, maps[0], TILE_SIZES[i], j });
+			benches.push_back({ "PlayerCollider::update", COLLIDER_SCENARIO_NAMES[j] + " tile=" + std::to_string(TILE_SIZES[i]),
+					COLLIDER_STEPS, moveCollider, &colliders.back() });
+		}
+	}
+
+	int const fillSizes[3] = { 32, 64, 128 };
+	for(int i = 0; i < 3; i++) {
+		fills.push_back({ fillMap(fillSizes[i], FILL_OPEN), -1 });
+		benches.push_back({ "floodFill", "open " + std::to_string(fillSizes[i]), 1, fill, &fills.back() });
+		//the winding path fills one row per pass, so the biggest one is left out
+		if(i == 2)
+			continue;
+		fills.push_back({ fillMap(fillSizes[i], FILL_WINDING), -1 });
+		benches.push_back({ "floodFill", "winding " + std::to_string(fillSizes[i]), 1, fill, &fills.back() });
+	}
+
+	int const queueDepths[3] = { 1, 16, 256 };
+	CommandQueue *queue = new CommandQueue();
+	for(int i = 0; i < 3; i++) {
+		queues.push_back({ queue, queueDepths[i] });
+		benches.push_back({ "CommandQueue", "depth=" + std::to_string(queueDepths[i]), QUEUE_COMMANDS*2, queueCommands, &queues.back() });
+	}
+
+	//entities split into jobs past ENTITY_PARALLEL_MIN, the way the game runs them
+	jobSystem = new JobSystem(SDL_GetCPUCount() - 1);
+	int const entityCounts[2] = { 1000, 10000 };
+	EntityStore *store = new EntityStore();
+	for(int i = 0; !maps.empty() && i < 2; i++) {
+		entityJobs.push_back({ store, maps[0], TILE_SIZES[2], entityCounts[i] });
+		benches.push_back({ "EntityStore::update", std::to_string(entityCounts[i]) + " entities", ENTITY_TICKS, stepEntities, &entityJobs.back() });
+	}
+
+	//every streamed world, both the way the simulation follows the player and the way the renderer does
+	std::vector<WorldMap*> worlds;
+	for(int i = 0; i < manifest->getCount(); i++) {
+		LevelEntry const &entry = manifest->get(i);
+		if(entry.places.empty())
+			continue;
+		worlds.push_back(new WorldMap(entry.places));
+		MapData *whole = readWholeWorld(worlds.back());
+		maps.push_back(whole);
+		for(int ahead = 0; ahead < 2; ahead++) {
+			worldJobs.push_back({ entry.name, worlds.back(), whole, TILE_SIZES[2], ahead == 1, 0 });
+			benches.push_back({ "WorldStreamer::follow", entry.name + (ahead ? " ahead" : " inline"), worldSteps(worlds.back()), streamWorld, &worldJobs.back() });
+		}
+	}
+
+	TileAnimations *animations = new TileAnimations(TILE_ANIMATIONS);
+	//one level at a time is made in here and thrown away after its run
+	Arena *levelArena = new Arena();
+	SoftwareCanvas *canvas = new SoftwareCanvas(renderer);
+	for(int i = 0; i < manifest->getCount(); i++) {
+		LevelEntry const *entry = &manifest->get(i);
+		for(int cold = 0; cold < 2; cold++) {
+			draws.push_back({ renderer, surface, i, entry, animations, false, nullptr, player, cold == 1, nullptr });
+			benches.push_back({ "GameLevel::draw", entry->name + (cold ? " cold" : " cached"), DRAW_FRAMES, drawLevel, &draws.back() });
+		}
+		draws.push_back({ renderer, surface, i, entry, animations, false, nullptr, player, false, canvas });
+		benches.push_back({ "GameLevel::draw", entry->name + " cpu", DRAW_FRAMES, drawLevel, &draws.back() });
+	}
+
+	//every tile of this one animated, against the same tiles standing still
+	LevelEntry animatedEntry = manifest->get(0);
+	animatedEntry.name = "Animated";
+	animatedEntry.map = ANIMATED_MAP;
+	animatedEntry.objects = "";
+	animatedEntry.places.clear();
+	TileAnimations *animatedTiles = nullptr;
+	if(writeAnimatedLevel()) {
+		animatedTiles = new TileAnimations(ANIMATED_LIST);
+		draws.push_back({ renderer, surface, 0, &animatedEntry, animations, false, nullptr, player, false, nullptr });
+		benches.push_back({ "GameLevel::draw", "Animated still", DRAW_FRAMES, drawLevel, &draws.back() });
+		for(int cold = 0; cold < 2; cold++) {
+			draws.push_back({ renderer, surface, 0, &animatedEntry, animatedTiles, true, nullptr, player, cold == 1, nullptr });
+			benches.push_back({ "GameLevel::draw", std::string("Animated") + (cold ? " cold" : " cached"), DRAW_FRAMES, drawLevel, &draws.back() });
+		}
+		draws.push_back({ renderer, surface, 0, &animatedEntry, animatedTiles, true, nullptr, player, false, canvas });
+		benches.push_back({ "GameLevel::draw", "Animated cpu", DRAW_FRAMES, drawLevel, &draws.back() });
+	}
+	else {
+		printf("Couldn't write the animated level, it's left out\n");
+	}
+
+	//loading messages all come before this, so everything after is results
+	SDL_version version;
+	SDL_GetVersion(&version);
+	printf("# SDL %d.%d.%d, %d cpus, %d warmup runs, times in ns per op\n", version.major, version.minor, version.patch,
+			SDL_GetCPUCount(), WARMUP_RUNS);
+	printf("benchmark,params,ops,runs,best_ns,median_ns,worst_ns,checksum\n");
+
+	for(unsigned int i = 0; i < benches.size(); i++) {
+		if(filter.size() && (benches[i].name + " " + benches[i].params).find(filter) == std::string::npos)
+			continue;
+		Benchmark &bench = benches[i];
+		if(bench.run == drawLevel) {
+			//levels need the player in them and their entities spawned
+			DrawJob *job = (DrawJob*)bench.data;
+			job->level = levelArena->make<GameLevel>(levelArena, renderer, job->id, *job->entry, TILESET, TILE_SIZES[2], job->animations);
+			job->level->setCanvas(job->canvas);
+			player->changeTileSize(TILE_SIZES[2]);
+			job->level->load(player, 0);
+			measure(bench, runs);
+			levelArena->reset();
+			job->level = nullptr;
+			continue;
+		}
+		if(bench.run == moveCollider)
+			player->changeTileSize(((ColliderJob*)bench.data)->tileSize);
+		measure(bench, runs);
+	}
+
+	//worlds were checked against reading them whole as they were walked, any difference fails the run
+	bool failed = false;
+	for(unsigned int i = 0; i < worldJobs.size(); i++) {
+		if(worldJobs[i].mismatches) {
+			printf("# %d streamed tiles of %s didn't match the world\n", worldJobs[i].mismatches, worldJobs[i].name.c_str());
+			failed = true;
+		}
+	}
+
+	//animated chunks only redraw the cells that changed, which has to come out the same as drawing them whole
+	if(animatedTiles && std::string("animated draw").find(filter) != std::string::npos) {
+		int different = checkAnimatedDraw(renderer, surface, levelArena, animatedEntry, animatedTiles, player);
+		if(different) {
+			printf("# %d frames of the animated level drew differently with cached chunks\n", different);
+			failed = true;
+		}
+	}
+
+#ifdef TRACK_ALLOCATIONS
+	//a check rather than a timing, it fails the run if play has started allocating again
+	if(std::string("steady play allocations").find(filter) != std::string::npos) {
+		if(steadyAllocations(renderer, manifest) > 0) {
+			printf("# steady play allocated, see above\n");
+			failed = true;
+		}
+	}
+#endif
+
+	for(unsigned int i = 0; i < maps.size(); i++) {
+		delete(maps[i]);
+	}
+	for(unsigned int i = 0; i < fills.size(); i++) {
+		delete(fills[i].map);
+	}
+	for(unsigned int i = 0; i < worlds.size(); i++) {
+		delete(worlds[i]);
+	}
+	delete(levelArena);
+	delete(canvas);
+	delete(animations);
+	if(animatedTiles) delete(animatedTiles);
+	remove(ANIMATED_MAP.c_str());
+	remove(ANIMATED_LIST.c_str());
+	delete(queue);
+	delete(store);
+	delete(jobSystem);
+	delete(player);
+	delete(manifest);
+	SDL_DestroyRenderer(renderer);
+	SDL_FreeSurface(surface);
+	IMG_Quit();
+	SDL_Quit();
+	if(failed)
+		return EXIT_FAILURE;
+	return 0;
+}
@@ -7,34 +7,93 @@
 #include "SDL2/SDL_ttf.h"
 #include "SDL2/SDL_mixer.h"
 #include "WindowAbstraction.h"
+#include "WindowsAndMenus.h"
+#include "GameData.h"
+#include "TextureCache.h"
 
 #ifndef CUTSCENES_H
 #define CUTSCENES_H
 
-void startCutscene(SDL_Renderer *renderer) {
-	std::string const filename = "Assets/Image/startCutscene.png";
-	int const length = 5000;
-	
-	SDL_Surface *sur = IMG_Load(filename.c_str());
-	SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, sur);
-	SDL_FreeSurface(sur);
-	SDL_RenderCopy(renderer, tex, NULL, NULL);
-	SDL_RenderPresent(renderer);
-	SDL_Delay(length);
-	SDL_DestroyTexture(tex);
-}
+/**
+ * Titles and images of the cutscenes, and how long each one stays up
+ */
+std::string const START_CUTSCENE = "Start Cutscene";
+std::string const END_CUTSCENE = "End Cutscene";
+std::string const START_CUTSCENE_IMAGE = "Assets/Image/startCutscene.png";
+std::string const END_CUTSCENE_IMAGE = "Assets/Image/endCutscene.png";
+unsigned int const CUTSCENE_LENGTH = 5000;
 
-void endCutscene(SDL_Renderer *renderer) {
-	std::string const filename = "Assets/Image/endCutscene.png";
-	int const length = 5000;
+/**
+ * A still image shown for a while, or until a key or click skips it.
+ * It is an ordinary Visual so the window keeps handling events and commands
+ * (and whatever is loading in the background carries on) while it is up
+ */
+class Cutscene : public Visual {
+	private:
+	std::string title;
+	std::string nextTitle;
+	std::string activeCommand;
+	SDL_Renderer *renderer;
+	SDL_Texture *texture;
+	CommandQueue *queue;
+	unsigned int length;
+	unsigned int startTime;
+	bool finished;
+	
+	public:
+	Cutscene(SDL_Renderer *renderer, CommandQueue *queue, std::string title, std::string image, std::string activeCommand, unsigned int length, std::string nextTitle) {
+		this->renderer = renderer;
+		this->queue = queue;
+		this->title = title;
+		this->activeCommand = activeCommand;
+		this->length = length;
+		this->nextTitle = nextTitle;
+		texture = loadTexture(renderer, image);
+		startTime = 0;
+		finished = true;
+	}
+	~Cutscene() {
+		if(texture) SDL_DestroyTexture(texture);
+	}
+	
+	std::string const &getTitle() {
+		return title;
+	}
+	
+	std::string onActive() {
+		startTime = SDL_GetTicks();
+		finished = false;
+		return activeCommand;
+	}
+	
+	/**
+	 * Ask the window to move on, once
+	 */
+	void finish() {
+		if(finished)
+			return;
+		finished = true;
+		queue->add("show " + nextTitle);
+	}
+	
+	void update() {
+		if(SDL_GetTicks() - startTime >= length)
+			finish();
+	}
+	
+	void draw() {
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+	}
 	
-	SDL_Surface *sur = IMG_Load(filename.c_str());
-	SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, sur);
-	SDL_FreeSurface(sur);
-	SDL_RenderCopy(renderer, tex, NULL, NULL);
-	SDL_RenderPresent(renderer);
-	SDL_Delay(length);
-	SDL_DestroyTexture(tex);
-}
+	//any key or click skips
+	void handleInput(SDL_Event event) {
+		if(event.type == SDL_KEYDOWN)
+			finish();
+	}
+	int click(int mouseX, int mouseY) {
+		finish();
+		return -1;
+	}
+};
 
 #endif
@@ -0,0 +1,118 @@
+//Draws the game scene below full resolution when frames run long
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+/**
+ * Bounds and step for the scene's resolution as a fraction of the logical size
+ */
+float const RENDER_SCALE_MIN = 0.5f;
+float const RENDER_SCALE_MAX = 1.0f;
+float const RENDER_SCALE_STEP = 0.05f;
+/**
+ * Drop resolution once frames average over the first fraction of the budget,
+ * raise it again once they are under the second. Frames to wait after a
+ * change so the average reflects the new scale before deciding again
+ */
+float const RENDER_SCALE_DROP_AT = 0.85f;
+float const RENDER_SCALE_RAISE_AT = 0.6f;
+int const RENDER_SCALE_SETTLE_FRAMES = 30;
+
+/**
+ * Renders into an offscreen target at some fraction of the logical size, then
+ * stretches that back over the screen. Drawing code keeps using logical
+ * coordinates; the render scale does the shrinking
+ */
+class DynamicResolution {
+	private:
+	SDL_Renderer *renderer;
+	SDL_Texture *target;
+	int width;
+	int height;
+	float scale;
+	float average;
+	int settle;
+
+	public:
+	DynamicResolution(SDL_Renderer *renderer) {
+		this->renderer = renderer;
+		target = nullptr;
+		width = 0;
+		height = 0;
+		scale = RENDER_SCALE_MAX;
+		average = 0;
+		settle = RENDER_SCALE_SETTLE_FRAMES;
+	}
+	~DynamicResolution() {
+		if(target) SDL_DestroyTexture(target);
+	}
+
+	/**
+	 * Size of the scene at full scale, the target is only remade when this changes
+	 */
+	void resize(int width, int height) {
+		if(target && width == this->width && height == this->height)
+			return;
+		this->width = width;
+		this->height = height;
+		if(target) SDL_DestroyTexture(target);
+		target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+								(int)(width*RENDER_SCALE_MAX + 0.5f), (int)(height*RENDER_SCALE_MAX + 0.5f));
+		if(!target)
+			printf("No offscreen target, drawing at full resolution: %s\n", SDL_GetError());
+	}
+
+	/**
+	 * Point drawing at the offscreen target, returns false if it has to go straight to the screen
+	 */
+	bool begin() {
+		if(!target || SDL_SetRenderTarget(renderer, target) != 0)
+			return false;
+		SDL_RenderSetScale(renderer, scale, scale);
+		SDL_Rect viewport = { 0, 0, width, height };
+		SDL_RenderSetViewport(renderer, &viewport);
+		return true;
+	}
+
+	/**
+	 * Back to the screen, stretching what was drawn over all of it
+	 */
+	void end() {
+		SDL_SetRenderTarget(renderer, NULL);
+		SDL_Rect source = { 0, 0, (int)(width*scale + 0.5f), (int)(height*scale + 0.5f) };
+		SDL_RenderCopy(renderer, target, &source, NULL);
+	}
+
+	/**
+	 * Feed in how long the last frame took to simulate, draw and present, and how long it had
+	 */
+	void frameTime(float ms, float budget) {
+		average = average ? average*0.9f + ms*0.1f : ms;
+		if(settle > 0) {
+			settle--;
+			return;
+		}
+		float next = scale;
+		if(average > budget*RENDER_SCALE_DROP_AT)
+			next = scale - RENDER_SCALE_STEP;
+		else if(average < budget*RENDER_SCALE_RAISE_AT)
+			next = scale + RENDER_SCALE_STEP;
+		next = next < RENDER_SCALE_MIN ? RENDER_SCALE_MIN : next > RENDER_SCALE_MAX ? RENDER_SCALE_MAX : next;
+		if(next != scale) {
+			scale = next;
+			settle = RENDER_SCALE_SETTLE_FRAMES;
+			printf("Render scale %.2f (%dx%d), frames averaging %.1fms of %.1fms\n", scale,
+					(int)(width*scale + 0.5f), (int)(height*scale + 0.5f), average, budget);
+		}
+	}
+
+	float getScale() {
+		return scale;
+	}
+};
+
+#endif
@@ -0,0 +1,60 @@
+//Flood fill over a grid of tiles, shared by the level editor and the benchmarks
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+/**
+ * Change the tile at x, y and every tile of the same value connected to it
+ * to newValue. Rows are w long and there are h of them
+ */
+void floodFill(int **data, int w, int h, int x, int y, int newValue) {
+	if(x < 0 || y < 0 || x >= w || y >= h) {
+		return;
+	}
+	
+	int oldValue = data[y][x];
+	data[y][x] = -2;
+	
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		for(int y = 0; y < h; y++) {
+			for(int x = 0; x < w; x++) {
+				if(data[y][x] == oldValue) {
+					if(x>0 && data[y][x-1] == -2) {
+						data[y][x] = -2;
+						changed = true;
+						continue;
+					}
+					if(x<w-1 && data[y][x+1] == -2) {
+						data[y][x] = -2;
+						changed = true;
+						continue;
+					}
+					if(y>0 && data[y-1][x] == -2) {
+						data[y][x] = -2;
+						changed = true;
+						continue;
+					}
+					if(y<h-1 && data[y+1][x] == -2) {
+						data[y][x] = -2;
+						changed = true;
+						continue;
+					}
+				}
+			}
+		}
+	}
+	for(int y = 0; y < h; y++) {
+		for(int x = 0; x < w; x++) {
+			if(data[y][x] == -2) {
+				data[y][x] = newValue;
+			}
+		}
+	}
+}
+
+#endif
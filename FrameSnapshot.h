@@ -0,0 +1,80 @@
+//What the simulation hands the renderer each tick
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+
+#ifndef FRAMESNAPSHOT_H
+#define FRAMESNAPSHOT_H
+
+/**
+ * Everything needed to draw one simulated tick, in world coordinates apart
+ * from the camera offset. Once published it is never written again until the
+ * renderer has let go of it
+ */
+struct GameSnapshot {
+	//ticks simulated when this was taken, 0 before the first one
+	Uint64 tick;
+	//level to draw, LEVEL_NONE until something has been published
+	int level;
+	SDL_Rect player;
+	int clip;
+	unsigned int stateTicks;
+	bool rightFacing;
+	int offX;
+	int offY;
+	std::vector<SDL_Rect> entityRects;
+	std::vector<int> entitySprites;
+};
+
+/**
+ * The shared slot holds an index, and this bit while the reader hasn't taken it yet
+ */
+int const SNAPSHOT_INDEX = 3;
+int const SNAPSHOT_FRESH = 4;
+
+/**
+ * Lock-free triple buffer between one writer and one reader. Each side owns
+ * a slot outright and only ever swaps it with the shared one, so the writer
+ * never waits on a slow frame and the reader always gets the newest whole tick
+ */
+class SnapshotBuffer {
+	private:
+	GameSnapshot slots[3];
+	SDL_atomic_t shared;
+	int writing;
+	int reading;
+
+	public:
+	SnapshotBuffer() {
+		for(int i = 0; i < 3; i++) {
+			slots[i].tick = 0;
+			slots[i].level = -1;
+		}
+		SDL_AtomicSet(&shared, 0);
+		writing = 1;
+		reading = 2;
+	}
+
+	/**
+	 * The writer's slot, fill it in then publish it
+	 */
+	GameSnapshot *back() {
+		return &slots[writing];
+	}
+
+	void publish() {
+		writing = SDL_AtomicSet(&shared, writing | SNAPSHOT_FRESH) & SNAPSHOT_INDEX;
+	}
+
+	/**
+	 * The newest published snapshot, or the last one again if nothing new has come in
+	 */
+	GameSnapshot const *latest() {
+		if(SDL_AtomicGet(&shared) & SNAPSHOT_FRESH)
+			reading = SDL_AtomicSet(&shared, reading) & SNAPSHOT_INDEX;
+		return &slots[reading];
+	}
+};
+
+#endif
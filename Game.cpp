@@ -12,6 +12,10 @@
 #include "PlayerLogic.h"
 #include "GameObject.h"
 #include "Cutscenes.h"
+#include "Audio.h"
+#include "AssetLoader.h"
+#include "InputQueue.h"
+#include "Allocations.h"
 
 /**
  * Store the coordinates of the mouse pointer
@@ -24,12 +28,24 @@ int mouseY = 0;
  */
 std::string WINDOW_TITLE = "Over The Clouds";
 
+/**
+ * Backdrop shared by every menu
+ */
+std::string const MENU_BACKGROUND = "Assets/Image/Clouds 2.png";
+
 /**
  * Windowed resolutions to toggle through
  */
 int const X_RESOLUTIONS[2][3] = { { 640, 1024, 1200 }, { 720, 1280, 1600 } };
 int const Y_RESOLUTIONS[2][3] = { { 480, 768, 900 }, { 480, 720, 900 } };
-int const TILE_SIZES[3] = {32,48,64};
+
+/**
+ * Everything is laid out and drawn at a fixed size for each ratio, then
+ * scaled by the renderer to whatever size the window actually is
+ */
+int const LOGICAL_WIDTHS[2] = { 1024, 1280 };
+int const LOGICAL_HEIGHTS[2] = { 768, 720 };
+int const TILE_SIZE = 48;
 int const FULLSCREEN_OPTIONS[3] = { 0, SDL_WINDOW_FULLSCREEN, SDL_WINDOW_FULLSCREEN_DESKTOP };
 int ratio = 1;
 int res = 1;
@@ -47,76 +63,110 @@ int SCREEN_HEIGHT = Y_RESOLUTIONS[ratio][res];
 int const FRAMERATE = 60;
 int const MS_DELAY = 1000/FRAMERATE;
 
-class MusicHandler {
-	private:
-	std::string currentSong;
-	Mix_Music *currentMusic;
-	
-	public:
-	MusicHandler() {
-	}
-	~MusicHandler() {
-		stop();
-	}
-	
-	void play(std::string arg) {
-		//printf("Try to play song %s\n",arg.c_str());
-		if(currentSong != arg) {
-			currentSong = arg;
-			currentMusic = Mix_LoadMUS(arg.c_str());
-			if(Mix_PlayMusic(currentMusic, -1) == -1) {
-				printf("Mix_PlayMusic: %s\n", Mix_GetError());
-			}
-		}
-	}
-	
-	void stop() {
-		//if(currentMusic) Mix_FreeMusic(currentMusic);
-		Mix_HaltMusic();
-		currentSong = "";
-		
-	}
-};
+/**
+ * Audio settings, a smaller buffer means sound effects start sooner
+ * but underruns (crackling) on slow machines, so raise it if that happens.
+ * The buffer can be changed without rebuilding by running ./Game [samples]
+ */
+int const AUDIO_FREQUENCY = 44100;
+int const AUDIO_BUFFER_SAMPLES = 512;
+std::string const SOUND_LIST = "Data/Sounds/Effects.sfx";
 
 class GameWindow : public Window {
 	CommandQueue *queue;
+	InputQueue *input;
 	MusicHandler *music;
+	SoundBank *sounds;
 	GameObject *object;
 	LevelState *levelState;
+	LevelManifest *manifest;
+	//every menu and cutscene and all their parts, made again on each build
+	Arena *menuArena;
 	std::string backTitle;
+	//commands are taken off the queue and split into these, which keep their buffers
+	std::string currentCommand;
+	std::string argument;
 	
 	public:
 	GameWindow(SDL_Renderer *renderer, SDL_Window *window) {
 		this->window = window;
-		SDL_GetWindowSize(window,&SCREEN_WIDTH,&SCREEN_HEIGHT);
+		SCREEN_WIDTH = LOGICAL_WIDTHS[ratio];
+		SCREEN_HEIGHT = LOGICAL_HEIGHTS[ratio];
+		SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
 		quit = false;
 		this->renderer = renderer;
 		activeVisual = nullptr;
 		this->activeTitle = WINDOW_TITLE;
 		this->queue = new CommandQueue();
+		this->input = new InputQueue();
 		this->music = new MusicHandler();
+		this->sounds = new SoundBank(SOUND_LIST, SOUND_CHANNELS);
+		this->menuArena = new Arena();
+		currentCommand.reserve(COMMAND_RESERVE);
+		argument.reserve(COMMAND_RESERVE);
 		backTitle = WINDOW_TITLE;
 		levelState = new LevelState("Data/savedata.sav");
-		object = new GameObject(renderer, queue, levelState, TILE_SIZES[res], SCREEN_WIDTH, SCREEN_HEIGHT);
+#ifdef BUILTIN_LEVELS
+		manifest = new LevelManifest();
+#else
+		manifest = new LevelManifest(LEVEL_MANIFEST);
+#endif
 		
-		build();
+		//decode every image the menus and levels need in parallel before building them
+		AssetLoader *loader = new AssetLoader(renderer);
+		loader->add(MENU_BACKGROUND);
+		loader->add(TILESET);
+		loader->add(START_CUTSCENE_IMAGE);
+		loader->add(END_CUTSCENE_IMAGE);
+		for(int i = 0; i < manifest->getCount(); i++) {
+			loader->add(manifest->get(i).background);
+		}
+		loader->run([this](int done, int total) { drawLoading(done, total); });
+		delete(loader);
+		
+		object = new GameObject(renderer, queue, input, levelState, manifest, sounds, TILE_SIZE, SCREEN_WIDTH, SCREEN_HEIGHT);
 		
+		build();
+		//everything is uploaded now, so the decoded copies can go
+		releasePreloaded();
 	}
 	~GameWindow() {
 		destroy();
+		menuArena->report("Menu");
+		delete(menuArena);
+		delete(object);
 		delete(levelState);
+		delete(manifest);
+		delete(music);
+		delete(sounds);
+		input->report(MS_DELAY);
+		delete(input);
+	}
+	
+	/**
+	 * Simple progress bar while the startup loader works
+	 */
+	void drawLoading(int done, int total) {
+		SDL_PumpEvents();
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+		SDL_Rect bar = { SCREEN_WIDTH/4, SCREEN_HEIGHT/2 - SCREEN_HEIGHT/40, SCREEN_WIDTH/2, SCREEN_HEIGHT/20 };
+		SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
+		SDL_RenderFillRect(renderer, &bar);
+		bar.w = total ? bar.w * done / total : bar.w;
+		SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+		SDL_RenderFillRect(renderer, &bar);
+		SDL_RenderPresent(renderer);
 	}
 	
 	void destroy() {
-		while(visuals.size()) {
-			//This warns about non-virtual destructor in Visual but if I add virtual deconstructor it segfaults...
-			//if(visuals.back()) delete(visuals.back());
-			visuals.pop_back();
-		}
+		//the game itself outlives rebuilds, everything else goes with the arena
+		visuals.clear();
 		while(logics.size()) {
 			if(logics.back()) delete(logics.back());
 			logics.pop_back();
 		}
+		menuArena->reset();
 	}
 	
 	void build() {
@@ -124,39 +174,47 @@ class GameWindow : public Window {
 		
 		//Assemble all the different menus
 		std::string buttons[3] = {"Start Game","Options","Quit"};
-		Menu *mainMenu = new Menu(renderer, WINDOW_TITLE, "Assets/Image/Clouds 2.png", "play Assets/Sound/Interlude.ogg", 3, buttons, 1, SCREEN_WIDTH, SCREEN_HEIGHT);
+		Menu *mainMenu = menuArena->make<Menu>(menuArena, renderer, WINDOW_TITLE, MENU_BACKGROUND, "play Assets/Sound/Interlude.ogg", 3, buttons, 1, SCREEN_WIDTH, SCREEN_HEIGHT);
 		visuals.push_back(mainMenu);
 		std::string buttons2[4] = {"Fullscreen","Switch Resolution","Switch Ratio", "Go Back"};
-		Menu *optionsMenu = new Menu(renderer, "Options", "Assets/Image/Clouds 2.png", "play Assets/Sound/Interlude.ogg", 4, buttons2, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		Menu *optionsMenu = menuArena->make<Menu>(menuArena, renderer, "Options", MENU_BACKGROUND, "play Assets/Sound/Interlude.ogg", 4, buttons2, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 		visuals.push_back(optionsMenu);
 		
 		std::string buttons3[3] = {"New Game","Load Game","Go Back"};
 		if(!levelState->doesFileExist())
 			buttons3[1] = "<No Data>";
-		Menu *fileMenu = new Menu(renderer, "Play Game", "Assets/Image/Clouds 2.png", "play Assets/Sound/Interlude.ogg", 3, buttons3, -1, SCREEN_WIDTH, SCREEN_HEIGHT);
+		Menu *fileMenu = menuArena->make<Menu>(menuArena, renderer, "Play Game", MENU_BACKGROUND, "play Assets/Sound/Interlude.ogg", 3, buttons3, -1, SCREEN_WIDTH, SCREEN_HEIGHT);
 		visuals.push_back(fileMenu);
 		
 		std::string buttons4[3] = {"Resume","Options","Main Menu"};
-		Menu *pauseMenu = new Menu(renderer, "Pause", "Assets/Image/Clouds 2.png", "play Assets/Sound/Interlude.ogg", 3, buttons4, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		Menu *pauseMenu = menuArena->make<Menu>(menuArena, renderer, "Pause", MENU_BACKGROUND, "play Assets/Sound/Interlude.ogg", 3, buttons4, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 		visuals.push_back(pauseMenu);
 		
+		visuals.push_back(menuArena->make<Cutscene>(renderer, queue, START_CUTSCENE, START_CUTSCENE_IMAGE, "play Assets/Sound/Interlude.ogg", CUTSCENE_LENGTH, "Game"));
+		visuals.push_back(menuArena->make<Cutscene>(renderer, queue, END_CUTSCENE, END_CUTSCENE_IMAGE, "play Assets/Sound/Interlude.ogg", CUTSCENE_LENGTH, "Game"));
+		
 		visuals.push_back(object);
 		object->resize(SCREEN_WIDTH, SCREEN_HEIGHT);
 		
 		changeVisual(activeTitle, 1);
 	}
 	
+	/**
+	 * Only the window changes size, the renderer scales the logical size to
+	 * fit. A new ratio is the one thing that needs the menus laid out again
+	 */
 	void resize(int width, int height) {
-		SCREEN_HEIGHT = height;
-		SCREEN_WIDTH = width;
 		SDL_SetWindowSize(window, width, height);
 		SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
-		object->resize(width, height);
-		object->changeTileSize(TILE_SIZES[res]);
-		build();
+		if(SCREEN_WIDTH != LOGICAL_WIDTHS[ratio] || SCREEN_HEIGHT != LOGICAL_HEIGHTS[ratio]) {
+			SCREEN_WIDTH = LOGICAL_WIDTHS[ratio];
+			SCREEN_HEIGHT = LOGICAL_HEIGHTS[ratio];
+			SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+			build();
+		}
 	}
 	
-	void changeVisual(std::string title, bool building) {
+	void changeVisual(std::string const &title, bool building) {
 		for(unsigned int i = 0; i < visuals.size(); i++) {
 			if(visuals.at(i)->getTitle() == title) {
 				activeVisual = visuals.at(i);
@@ -165,34 +223,50 @@ class GameWindow : public Window {
 					backTitle = activeTitle;
 				if(activeTitle == "Game")
 					object->onInactive();
-				activeTitle = title;
+				//title can be backTitle itself, which has just changed, so take the visual's
+				activeTitle = activeVisual->getTitle();
 				break;
 			}
 		}
 	}
 	
-	void changeVisual(std::string title) {
+	void changeVisual(std::string const &title) {
 		changeVisual(title, 0);
 	}
 	
+	/**
+	 * Whether the game is being played, the one time nothing should be allocated
+	 */
+	bool isPlaying() {
+		return activeTitle == "Game";
+	}
+	
 	void parseQueue() {
-		while(!queue->isEmpty()) {
-			std::string currentCommand = queue->remove();
+		while(queue->remove(currentCommand)) {
 			parseCommand(currentCommand);
 		}
+		music->update();
 	}
 	
-	void parseCommand(std::string command) {
-		std::string base = command.substr(0,command.find(' ',0));
-		std::string arg = command.substr(command.find(' ',0)+1,command.length()-command.find(' ',0));
-		if(base == "play") {
-			music->play(arg);
+	void parseCommand(std::string const &command) {
+		//compare the first word in place and copy the rest into a kept buffer, so nothing allocates
+		size_t space = command.find(' ');
+		size_t baseLength = space == std::string::npos ? command.length() : space;
+		argument.assign(command, space == std::string::npos ? 0 : space + 1, std::string::npos);
+		if(command.compare(0, baseLength, "play") == 0) {
+			music->play(argument);
 		}
-		else if(base == "stop") {
+		else if(command.compare(0, baseLength, "prefetch") == 0) {
+			music->prefetch(argument);
+		}
+		else if(command.compare(0, baseLength, "show") == 0) {
+			changeVisual(argument);
+		}
+		else if(command.compare(0, baseLength, "stop") == 0) {
 			music->stop();
 		}
 		else {
-			printf("Unknown command '%s'\n",base.c_str());
+			printf("Unknown command '%.*s'\n",(int)baseLength,command.c_str());
 		}
 	}
 	
@@ -200,6 +274,18 @@ class GameWindow : public Window {
 		activeVisual->update();
 	}
 	
+	void presented() {
+		input->presented(object->getShownTick());
+	}
+	
+	/**
+	 * Only the game scene scales, so only its frames count
+	 */
+	void frameTime(float ms) {
+		if(activeTitle == "Game")
+			object->frameTime(ms, MS_DELAY);
+	}
+	
 	void handleEvent(SDL_Event event) {
 		activeVisual->hover(mouseX, mouseY);
 		
@@ -251,8 +337,9 @@ class GameWindow : public Window {
 						levelState->deleteSave();
 						object->reloadState();
 						object->reset();
-						startCutscene(renderer);
-						changeVisual("Game");
+						//the level's music loads in the background while the cutscene plays
+						queue->add("prefetch " + object->getMusic());
+						changeVisual(START_CUTSCENE);
 						break;
 					case 1:
 						//Load game
@@ -289,67 +376,108 @@ class GameWindow : public Window {
 		}
 		//Keys matter
 		else if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
-			if(activeVisual->getTitle() == "Game") {
-				if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) {
-					//go to pause menu
-					changeVisual("Pause");
-				}
-				else {
-					activeVisual->handleInput(event);
-				}
+			if(activeVisual->getTitle() == "Game" && event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) {
+				//go to pause menu, which stops the simulation once the player has taken the keys from before this
+				changeVisual("Pause");
+				input->discard();
+			}
+			else if(activeVisual->getTitle() == "Game") {
+				//the simulation takes its keys on its next tick
+				input->push(event);
+			}
+			else {
+				//lets cutscenes be skipped
+				activeVisual->handleInput(event);
+			}
+		}
+		//some renderers throw away render target contents, so cached menus have to be redrawn
+		if(event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+			for(unsigned int i = 0; i < visuals.size(); i++) {
+				visuals.at(i)->invalidate();
 			}
 		}
 		if(event.type == SDL_WINDOWEVENT) {
 			if(event.window.event == SDL_WINDOWEVENT_CLOSE) {
 				quit = true;
 			}
-			else if(event.window.event == SDL_WINDOWEVENT_RESIZED) {
-				resize(event.window.data1, event.window.data2);
-			}
 		}
-		
-		SDL_PumpEvents();
-		SDL_FlushEvents(SDL_FIRSTEVENT,SDL_APP_DIDENTERFOREGROUND);
-		SDL_FlushEvents(SDL_TEXTEDITING,SDL_MOUSEMOTION);
-		SDL_FlushEvents(SDL_MOUSEWHEEL,SDL_LASTEVENT);
 	}
 };
 
 //Setup, loop, etc.
 //-------------------------------------------------------------------------
-int main() {
+int main(int argc, char *argv[]) {
+	int audioBuffer = argc > 1 ? atoi(argv[1]) : AUDIO_BUFFER_SAMPLES;
+	if(audioBuffer <= 0) {
+		printf("Audio buffer '%s' isn't a number of samples, using %d\n", argv[1], AUDIO_BUFFER_SAMPLES);
+		audioBuffer = AUDIO_BUFFER_SAMPLES;
+	}
 	//start SDL
 	SDL_Init(SDL_INIT_AUDIO);
 	IMG_Init(IMG_INIT_PNG);
 	TTF_Init();
 	Mix_Init(MIX_INIT_MP3|MIX_INIT_OGG);
-	Mix_OpenAudio(44100,MIX_DEFAULT_FORMAT,2,2048);
+	//use the asset pack if one has been built, otherwise the loose files
+	assetPack = AssetPack::open(PACK_FILENAME);
+	//one worker per core besides this one
+	jobSystem = new JobSystem(SDL_GetCPUCount() - 1);
+	Mix_OpenAudio(AUDIO_FREQUENCY,MIX_DEFAULT_FORMAT,2,audioBuffer);
 	SDL_Window *window = SDL_CreateWindow(WINDOW_TITLE.c_str(),SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED,SCREEN_WIDTH,SCREEN_HEIGHT,0);
-	SDL_Surface *icon = IMG_Load("Assets/Image/Character/icon.png");
+	SDL_Surface *icon = loadImage("Assets/Image/Character/icon.png");
 	SDL_SetWindowIcon(window, icon);
 	SDL_FreeSurface(icon);
 	SDL_SetWindowResizable(window,SDL_TRUE);
 	SDL_Renderer *renderer  = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+	if(!renderer) {
+		//no usable GPU, so the levels get drawn on the CPU
+		printf("No accelerated renderer, using software: %s\n", SDL_GetError());
+		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+	}
+	if(!renderer) {
+		printf("Couldn't make a renderer: %s\n", SDL_GetError());
+		throw;
+	}
 	SDL_SetRenderDrawBlendMode(renderer,SDL_BLENDMODE_BLEND);
 	SDL_Event event;
 	
 	GameWindow *gameWindow = new GameWindow(renderer, window);
 	unsigned int lastTime = SDL_GetTicks();
+	//frames of play from start to end shouldn't allocate at all
+	FrameAllocations frameAllocations;
 	//main loop
 	while(!gameWindow->shouldQuit()) {
+		Uint64 frameStart = SDL_GetPerformanceCounter();
+		bool playing = gameWindow->isPlaying();
+		frameAllocations.begin();
 		while(SDL_PollEvent(&event)) {
-			SDL_GetMouseState(&mouseX, &mouseY);
+			//mouse events come already scaled to the logical size, unlike SDL_GetMouseState
+			if(event.type == SDL_MOUSEMOTION) {
+				mouseX = event.motion.x;
+				mouseY = event.motion.y;
+			}
+			else if(event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP) {
+				mouseX = event.button.x;
+				mouseY = event.button.y;
+			}
 			gameWindow->handleEvent(event);
 		}
 		gameWindow->update();
 		gameWindow->parseQueue();
 		gameWindow->draw();
 		SDL_RenderPresent(renderer);
+		gameWindow->presented();
+		gameWindow->frameTime((SDL_GetPerformanceCounter() - frameStart)*1000.0f/SDL_GetPerformanceFrequency());
+		frameAllocations.end(playing && gameWindow->isPlaying());
 		unsigned int elapsedTime = SDL_GetTicks() - lastTime;
 		lastTime = SDL_GetTicks();
 		SDL_Delay(elapsedTime <= MS_DELAY ? MS_DELAY - elapsedTime : 0);
 	}
 
+	frameAllocations.report("Play");
+	//garbage collect while the renderer and mixer are still around
+	delete(gameWindow);
+	delete(jobSystem);
+
 	//quit SDL
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
@@ -358,9 +486,7 @@ int main() {
 	Mix_CloseAudio();
 	Mix_Quit();
 	SDL_Quit();
-
-	//garbage collect
-	delete(gameWindow);
+	delete(assetPack);
 	
 	//and done
 	return 0;
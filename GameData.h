@@ -2,40 +2,73 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
 #include "SDL2/SDL_ttf.h"
+#include "AssetPack.h"
+#include "Arena.h"
 
 #ifndef GAMEDATA_H
 #define GAMEDATA_H
 
 /**
- * Basic wrapper for 2D int array
+ * Rounds toward negative infinity, so the tile or chunk left of 0 is -1
+ */
+int floorDivide(int a, int b) {
+	return a >= 0 ? a/b : -((-a + b - 1)/b);
+}
+
+/**
+ * Basic wrapper for 2D int array. The origin is the world tile the first
+ * entry sits on, which is only ever moved for streamed worlds. The rows are
+ * one block, taken from an arena when there is one, which then frees them
  */
 class MapData {
 	private:
 	int w;
 	int h;
 	int **data;
+	int *cells;
+	Arena *arena;
+	int originX;
+	int originY;
 	
 	public:
-	MapData(int w, int h) {
+	MapData(int w, int h) : MapData(w, h, nullptr) {
+	}
+	MapData(int w, int h, Arena *arena) {
 		this->w = w;
 		this->h = h;
-		int **arr1 = (int**)calloc(h,sizeof(int*));
+		this->arena = arena;
+		originX = 0;
+		originY = 0;
+		if(arena) {
+			data = arena->makeArray<int*>(h);
+			cells = arena->makeArray<int>((size_t)w*h);
+		}
+		else {
+			data = (int**)calloc(h,sizeof(int*));
+			cells = (int*)calloc((size_t)w*h,sizeof(int));
+		}
 		for(int i = 0; i < h; i++) {
-			int *arr2 = (int*)calloc(w,sizeof(int));
-			arr1[i] = arr2;
+			data[i] = cells + (size_t)i*w;
 		}
-		data = arr1;
 	}
 	~MapData() {
-		for(int i = 0; i < h; i++) {
-			free(data[i]);
-		}
+		if(arena)
+			return;
+		free(cells);
 		free(data);
 	}
 	
+	/**
+	 * Whether its tiles are in an arena, which frees them along with everything else
+	 */
+	bool inArena() const {
+		return arena != nullptr;
+	}
+	
 	int **getData() {
 		return data;
 	}
@@ -47,39 +80,147 @@ class MapData {
 		return h;
 	}
 	
+	void setOrigin(int x, int y) {
+		originX = x;
+		originY = y;
+	}
+	int getOriginX() {
+		return originX;
+	}
+	int getOriginY() {
+		return originY;
+	}
+	
+	/**
+	 * Whether any of a world pixel rect is on the tiles held here
+	 */
+	bool overlaps(int x, int y, int w, int h, int tileSize) {
+		x -= originX*tileSize;
+		y -= originY*tileSize;
+		return x + w > 0 && x < tileSize*this->w && y + h > 0 && y < tileSize*this->h;
+	}
+	
 	int valueAtPoint(int x, int y, int tileSize) {
+		x -= originX*tileSize;
+		y -= originY*tileSize;
 		if(x < 0 || x >= tileSize*w || y < 0 || y >= tileSize*h)
 			return -1;
 		//printf("Tile %d,%d = %d\n",x/tileSize,y/tileSize, data[x/tileSize][y/tileSize]);
 		return data[y/tileSize][x/tileSize];
 	}
+	
+	/**
+	 * Whether any tile touched by the vertical pixel line x, top..bottom is solid.
+	 * This is the tile collision the player and every entity share
+	 */
+	bool solidColumn(int x, int top, int bottom, int tileSize) {
+		x -= originX*tileSize;
+		top -= originY*tileSize;
+		bottom -= originY*tileSize;
+		if(x < 0 || x >= tileSize*w)
+			return false;
+		top = top < 0 ? 0 : top;
+		bottom = bottom >= tileSize*h ? tileSize*h - 1 : bottom;
+		for(int y = top/tileSize; top <= bottom && y <= bottom/tileSize; y++) {
+			if(data[y][x/tileSize] != -1)
+				return true;
+		}
+		return false;
+	}
+	
+	/**
+	 * Same again for the horizontal pixel line left..right, y
+	 */
+	bool solidRow(int y, int left, int right, int tileSize) {
+		y -= originY*tileSize;
+		left -= originX*tileSize;
+		right -= originX*tileSize;
+		if(y < 0 || y >= tileSize*h)
+			return false;
+		left = left < 0 ? 0 : left;
+		right = right >= tileSize*w ? tileSize*w - 1 : right;
+		int *row = data[y/tileSize];
+		for(int x = left/tileSize; left <= right && x <= right/tileSize; x++) {
+			if(row[x] != -1)
+				return true;
+		}
+		return false;
+	}
 };
 
+/**
+ * A map in an arena has nothing of its own to free
+ */
+template<>
+bool arenaNeedsCleanup<MapData>(MapData const *map) {
+	return !map->inArena();
+}
+
 
 
+/**
+ * Commands are kept in a ring of strings made up front, each with room for
+ * COMMAND_RESERVE characters, so passing one along doesn't allocate. The
+ * ring only grows if more than COMMAND_QUEUE_SLOTS are waiting at once
+ */
+int const COMMAND_QUEUE_SLOTS = 16;
+int const COMMAND_RESERVE = 128;
+
 /**
  * Command queue for the visuals to pass up higher level commands
  */
 class CommandQueue {
 	private:
-	std::vector<std::string> strings;
+	std::vector<std::string> slots;
+	unsigned int head;
+	unsigned int count;
+	//the simulation thread adds commands too
+	SDL_mutex *lock;
 	
 	public:
 	CommandQueue() {
+		slots.resize(COMMAND_QUEUE_SLOTS);
+		for(unsigned int i = 0; i < slots.size(); i++) {
+			slots[i].reserve(COMMAND_RESERVE);
+		}
+		head = 0;
+		count = 0;
+		lock = SDL_CreateMutex();
 	}
 	~CommandQueue() {
+		SDL_DestroyMutex(lock);
 	}
 	
-	void add(std::string command) {
-		strings.push_back(command);
+	void add(std::string const &command) {
+		SDL_LockMutex(lock);
+		if(count == slots.size()) {
+			//full, so line the ring up from the start and double it
+			std::rotate(slots.begin(), slots.begin() + head, slots.end());
+			head = 0;
+			slots.resize(2*slots.size());
+			for(unsigned int i = count; i < slots.size(); i++) {
+				slots[i].reserve(COMMAND_RESERVE);
+			}
+		}
+		slots[(head + count)%slots.size()].assign(command);
+		count++;
+		SDL_UnlockMutex(lock);
 	}
 	
-	std::string remove() {
-		if(isEmpty())
-			return nullptr;
-		std::string output = strings.front();
-		strings.erase(strings.begin());
-		return output;
+	/**
+	 * Take the oldest command, false if there isn't one. The command is
+	 * swapped into the given string, whose buffer goes back into the ring
+	 */
+	bool remove(std::string &command) {
+		SDL_LockMutex(lock);
+		bool found = count > 0;
+		if(found) {
+			command.swap(slots[head]);
+			head = (head + 1)%slots.size();
+			count--;
+		}
+		SDL_UnlockMutex(lock);
+		return found;
 	}
 	
 	bool isEmpty() {
@@ -87,25 +228,147 @@ class CommandQueue {
 	}
 	
 	int size() {
-		return strings.size();
+		SDL_LockMutex(lock);
+		int size = count;
+		SDL_UnlockMutex(lock);
+		return size;
 	}
 };
 
+/**
+ * Read one int the way getw does, EOF if there isn't one
+ */
+int readInt(SDL_RWops *rw) {
+	int value = EOF;
+	SDL_RWread(rw, &value, sizeof(int), 1);
+	return value;
+}
+
+/**
+ * A map file is either a single layer, stored as width, height and then each
+ * row, or MAP_LAYERS_MARKER, the layer count, width and height, then for each
+ * layer its kind, its parallax in hundredths and its rows. A single layer map
+ * is the collision layer
+ */
+int const MAP_LAYERS_MARKER = -1;
+int const LAYER_BACKGROUND = 0;
+int const LAYER_COLLISION = 1;
+int const LAYER_FOREGROUND = 2;
+int const LAYER_KINDS = 3;
+std::string const LAYER_KIND_NAMES[LAYER_KINDS] = { "background", "collision", "foreground" };
+
+/**
+ * One layer of tiles. Parallax is how far it scrolls for each pixel the
+ * camera does, so background layers below 1 drift behind the level
+ */
+struct MapLayer {
+	int kind;
+	float parallax;
+	MapData *tiles;
+};
+
+/**
+ * Read the size of a map and where the rows of its collision layer start.
+ * Maps with no layer marked collision collide with their first layer
+ */
+bool readMapHeader(SDL_RWops *rw, int *w, int *h, Sint64 *collisionRows) {
+	int first = readInt(rw);
+	if(first != MAP_LAYERS_MARKER) {
+		*w = first;
+		*h = readInt(rw);
+		*collisionRows = 2*sizeof(int);
+		return *w > 0 && *h > 0;
+	}
+	int count = readInt(rw);
+	*w = readInt(rw);
+	*h = readInt(rw);
+	if(count <= 0 || *w <= 0 || *h <= 0)
+		return false;
+	*collisionRows = 6*sizeof(int);
+	for(int i = 0; i < count; i++) {
+		//layer i's kind and parallax sit just before its rows
+		Sint64 rows = (4 + 2*(i + 1) + (Sint64)i*(*w)*(*h))*sizeof(int);
+		SDL_RWseek(rw, rows - 2*sizeof(int), RW_SEEK_SET);
+		if(readInt(rw) == LAYER_COLLISION) {
+			*collisionRows = rows;
+			break;
+		}
+	}
+	return true;
+}
+
+/**
+ * Every layer of a map, backgrounds first, then the collision layer, then
+ * foregrounds. With an arena the layers' tiles are made in it
+ */
+std::vector<MapLayer> readLayers(std::string filename, Arena *arena) {
+	SDL_RWops *rw = openAsset(filename);
+	if(!rw) {
+		throw;
+	}
+	std::vector<MapLayer> layers;
+	int first = readInt(rw);
+	int count = 1;
+	int w = first;
+	int h;
+	if(first == MAP_LAYERS_MARKER) {
+		count = readInt(rw);
+		w = readInt(rw);
+	}
+	h = readInt(rw);
+	bool collision = false;
+	for(int i = 0; i < count; i++) {
+		MapLayer layer = { LAYER_COLLISION, 1.0f, arena ? arena->make<MapData>(w, h, arena) : new MapData(w, h) };
+		if(first == MAP_LAYERS_MARKER) {
+			layer.kind = readInt(rw);
+			layer.parallax = readInt(rw)/100.0f;
+		}
+		//only one layer collides, any others marked collision just draw with it
+		layer.kind = layer.kind < 0 || layer.kind >= LAYER_KINDS || (layer.kind == LAYER_COLLISION && collision) ? LAYER_FOREGROUND : layer.kind;
+		collision = collision || layer.kind == LAYER_COLLISION;
+		int **theData = layer.tiles->getData();
+		//rows are stored contiguously, and held that way too, so the layer is one read
+		if(h > 0)
+			SDL_RWread(rw, theData[0], sizeof(int), (size_t)w*h);
+		layers.push_back(layer);
+	}
+	SDL_RWclose(rw);
+	if(!collision)
+		layers[0].kind = LAYER_COLLISION;
+	std::stable_sort(layers.begin(), layers.end(), [](MapLayer const &a, MapLayer const &b) { return a.kind < b.kind; });
+	for(unsigned int i = 0; i < layers.size(); i++) {
+		if(layers[i].kind == LAYER_COLLISION)
+			layers[i].parallax = 1.0f;
+	}
+	return layers;
+}
+std::vector<MapLayer> readLayers(std::string filename) {
+	return readLayers(filename, nullptr);
+}
+
+/**
+ * Just the collision layer of a map
+ */
 MapData *readFile(std::string filename) {
-	FILE *fp = fopen(filename.c_str(), "r");
-	if(!fp) {
+	SDL_RWops *rw = openAsset(filename);
+	if(!rw) {
+		throw;
+	}
+	int w;
+	int h;
+	Sint64 rows;
+	if(!readMapHeader(rw, &w, &h, &rows)) {
+		printf("Map '%s' is damaged\n", filename.c_str());
+		SDL_RWclose(rw);
 		throw;
 	}
-	int w = getw(fp);
-	int h = getw(fp);
 	//printf("Loading file: %d x %d\n",w, h);
 	MapData *data = new MapData(w, h);
 	int **theData = data->getData();
-	for(int y = 0; y < h; y++) {
-		for(int x = 0; x < w; x++) {
-			theData[y][x] = getw(fp);
-		}
-	}
+	SDL_RWseek(rw, rows, RW_SEEK_SET);
+	//rows are stored contiguously, and held that way too, so the layer is one read
+	SDL_RWread(rw, theData[0], sizeof(int), (size_t)w*h);
+	SDL_RWclose(rw);
 	
 	return data;
 }
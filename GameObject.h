@@ -2,6 +2,7 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <cmath>
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
 #include "SDL2/SDL_ttf.h"
@@ -11,86 +12,469 @@
 #include "GameData.h"
 #include "PlayerLogic.h"
 #include "LevelInfo.h"
+#include "LevelManifest.h"
 #include "LevelState.h"
 #include "Cutscenes.h"
+#include "DynamicResolution.h"
+#include "JobSystem.h"
+#include "FrameSnapshot.h"
+#include "InputQueue.h"
+#include "WorldMap.h"
+#include "LayerCache.h"
+#include "TileAnimation.h"
+#include "SoftwareTiles.h"
 
 #ifndef GAMEOBJECT_H
 #define GAMEOBJECT_H
 
+/**
+ * Kinds of entity a level's object list can spawn
+ */
+int const ENTITY_HAZARD = 0;
+int const ENTITY_COLLECTIBLE = 1;
+int const ENTITY_PLATFORM = 2;
+int const ENTITY_KINDS = 3;
+std::string const ENTITY_KIND_NAMES[ENTITY_KINDS] = { "hazard", "collectible", "platform" };
+/**
+ * Below this many entities the update isn't worth splitting across threads
+ */
+int const ENTITY_PARALLEL_MIN = 2048;
+int const ENTITY_BATCH = 1024;
+/**
+ * The simulation gives up on catching up once it falls this many ticks behind
+ */
+int const SIM_MAX_BEHIND = 5;
+
+/**
+ * What the window knows the game by
+ */
+std::string const GAME_TITLE = "Game";
+
+/**
+ * One line of a level's object list, all in tiles and tiles per second
+ */
+struct EntitySpawn {
+	int kind;
+	int sprite;
+	float x;
+	float y;
+	float w;
+	float h;
+	float vx;
+	float vy;
+	float range;
+};
+
+/**
+ * Read an object list, one entity per line:
+ *   <kind> <x> <y> <w> <h> <sprite> [<vx> <vy> <range>]
+ * where sprite is a tile from the level's tileset and range is how far it can
+ * move from where it started before turning round, 0 for no limit
+ */
+std::vector<EntitySpawn> readObjects(std::string filename) {
+	std::vector<EntitySpawn> spawns;
+	char *text = loadText(filename);
+	if(!text) {
+		printf("Could not load object list '%s'\n", filename.c_str());
+		return spawns;
+	}
+	char *cursor = text;
+	char *line;
+	while((line = nextLine(&cursor))) {
+		char kind[32] = { 0 };
+		EntitySpawn spawn = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+		if(line[0] == '#' || sscanf(line, "%31s %f %f %f %f %d %f %f %f", kind, &spawn.x, &spawn.y, &spawn.w, &spawn.h,
+									&spawn.sprite, &spawn.vx, &spawn.vy, &spawn.range) < 6)
+			continue;
+		spawn.kind = -1;
+		for(int i = 0; i < ENTITY_KINDS; i++) {
+			if(ENTITY_KIND_NAMES[i] == kind)
+				spawn.kind = i;
+		}
+		if(spawn.kind < 0) {
+			printf("Unknown entity '%s' in '%s'\n", kind, filename.c_str());
+			continue;
+		}
+		spawns.push_back(spawn);
+	}
+	SDL_free(text);
+	return spawns;
+}
+
+/**
+ * Every entity in a level, one array per component so each pass only walks
+ * the data it needs. Positions are in pixels at the level's tile size.
+ * Removing swaps the last entity into the gap, so indices don't last past a removal
+ */
+class EntityStore {
+	private:
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> w;
+	std::vector<float> h;
+	std::vector<float> originX;
+	std::vector<float> originY;
+	std::vector<float> range;
+	//how far each entity moved this tick
+	std::vector<float> dx;
+	std::vector<float> dy;
+	std::vector<int> sprite;
+	std::vector<int> kind;
+	
+	public:
+	int size() {
+		return x.size();
+	}
+	
+	void clear() {
+		x.clear(); y.clear(); vx.clear(); vy.clear(); w.clear(); h.clear();
+		originX.clear(); originY.clear(); range.clear(); dx.clear(); dy.clear();
+		sprite.clear(); kind.clear();
+	}
+	
+	void reserve(int count) {
+		x.reserve(count); y.reserve(count); vx.reserve(count); vy.reserve(count); w.reserve(count); h.reserve(count);
+		originX.reserve(count); originY.reserve(count); range.reserve(count); dx.reserve(count); dy.reserve(count);
+		sprite.reserve(count); kind.reserve(count);
+	}
+	
+	void spawn(EntitySpawn const &spawn, int tileSize) {
+		x.push_back(spawn.x*tileSize);
+		y.push_back(spawn.y*tileSize);
+		vx.push_back(spawn.vx*tileSize);
+		vy.push_back(spawn.vy*tileSize);
+		w.push_back(spawn.w*tileSize);
+		h.push_back(spawn.h*tileSize);
+		originX.push_back(spawn.x*tileSize);
+		originY.push_back(spawn.y*tileSize);
+		range.push_back(spawn.range*tileSize);
+		dx.push_back(0);
+		dy.push_back(0);
+		sprite.push_back(spawn.sprite);
+		kind.push_back(spawn.kind);
+	}
+	
+	void remove(int i) {
+		int last = size() - 1;
+		x[i] = x[last]; y[i] = y[last]; vx[i] = vx[last]; vy[i] = vy[last]; w[i] = w[last]; h[i] = h[last];
+		originX[i] = originX[last]; originY[i] = originY[last]; range[i] = range[last];
+		dx[i] = dx[last]; dy[i] = dy[last]; sprite[i] = sprite[last]; kind[i] = kind[last];
+		x.pop_back(); y.pop_back(); vx.pop_back(); vy.pop_back(); w.pop_back(); h.pop_back();
+		originX.pop_back(); originY.pop_back(); range.pop_back(); dx.pop_back(); dy.pop_back();
+		sprite.pop_back(); kind.pop_back();
+	}
+	
+	/**
+	 * Scale everything to a new tile size
+	 */
+	void rescale(float factor) {
+		for(int i = 0; i < size(); i++) {
+			x[i] *= factor; y[i] *= factor; vx[i] *= factor; vy[i] *= factor; w[i] *= factor; h[i] *= factor;
+			originX[i] *= factor; originY[i] *= factor; range[i] *= factor;
+		}
+	}
+	
+	SDL_Rect getRect(int i) {
+		return { (int)x[i], (int)y[i], (int)w[i], (int)h[i] };
+	}
+	
+	/**
+	 * Step every entity, turning round at solid tiles and at the edge of its range.
+	 * Entities don't affect each other here, so big levels split it into jobs
+	 */
+	void update(float seconds, MapData *map, int tileSize) {
+		UpdateJob job = { this, seconds, map, tileSize };
+		if(!jobSystem || size() < ENTITY_PARALLEL_MIN) {
+			updateSlice(&job, 0, size());
+			return;
+		}
+		JobCounter counter;
+		SDL_AtomicSet(&counter.pending, 0);
+		jobSystem->parallelFor(size(), ENTITY_BATCH, updateSlice, &job, &counter);
+		jobSystem->wait(&counter);
+	}
+	
+	private:
+	struct UpdateJob {
+		EntityStore *store;
+		float seconds;
+		MapData *map;
+		int tileSize;
+	};
+	
+	static void updateSlice(void *data, int begin, int end) {
+		UpdateJob *job = (UpdateJob*)data;
+		job->store->step(job->seconds, job->map, job->tileSize, begin, end);
+	}
+	
+	void step(float seconds, MapData *map, int tileSize, int begin, int end) {
+		for(int i = begin; i < end; i++) {
+			//entities off the streamed part of a world wait until it comes back
+			bool resident = map->overlaps((int)x[i], (int)y[i], (int)w[i], (int)h[i], tileSize);
+			dx[i] = resident ? vx[i]*seconds : 0;
+			dy[i] = resident ? vy[i]*seconds : 0;
+		}
+		for(int i = begin; i < end; i++) {
+			if(dx[i] > 0 ? map->solidColumn((int)(x[i] + w[i] + dx[i]), (int)y[i], (int)(y[i] + h[i]) - 1, tileSize)
+			: dx[i] < 0 && map->solidColumn((int)floorf(x[i] + dx[i]), (int)y[i], (int)(y[i] + h[i]) - 1, tileSize)) {
+				vx[i] = -vx[i];
+				dx[i] = 0;
+			}
+			if(dy[i] > 0 ? map->solidRow((int)(y[i] + h[i] + dy[i]), (int)x[i], (int)(x[i] + w[i]) - 1, tileSize)
+			: dy[i] < 0 && map->solidRow((int)floorf(y[i] + dy[i]), (int)x[i], (int)(x[i] + w[i]) - 1, tileSize)) {
+				vy[i] = -vy[i];
+				dy[i] = 0;
+			}
+		}
+		for(int i = begin; i < end; i++) {
+			if(range[i] <= 0)
+				continue;
+			if(fabsf(x[i] + dx[i] - originX[i]) > range[i]) {
+				vx[i] = -vx[i];
+				dx[i] = 0;
+			}
+			if(fabsf(y[i] + dy[i] - originY[i]) > range[i]) {
+				vy[i] = -vy[i];
+				dy[i] = 0;
+			}
+		}
+		for(int i = begin; i < end; i++) {
+			x[i] += dx[i];
+			y[i] += dy[i];
+		}
+	}
+	
+	public:
+	
+	/**
+	 * The platform a rect is standing on, -1 for none
+	 */
+	int platformUnder(SDL_Rect rect) {
+		int feet = rect.y + rect.h + 1;
+		for(int i = 0; i < size(); i++) {
+			if(kind[i] != ENTITY_PLATFORM)
+				continue;
+			SDL_Rect p = getRect(i);
+			if(feet >= p.y && feet < p.y + p.h && rect.x + rect.w >= p.x && rect.x < p.x + p.w)
+				return i;
+		}
+		return -1;
+	}
+	
+	/**
+	 * Whole pixels a platform moved this tick
+	 */
+	void moved(int i, int *carryX, int *carryY) {
+		*carryX = (int)x[i] - (int)(x[i] - dx[i]);
+		*carryY = (int)y[i] - (int)(y[i] - dy[i]);
+	}
+	
+	/**
+	 * Collect the rects of platforms overlapping an area
+	 */
+	void platformsNear(SDL_Rect area, std::vector<SDL_Rect> &out) {
+		for(int i = 0; i < size(); i++) {
+			if(kind[i] != ENTITY_PLATFORM)
+				continue;
+			if(x[i] < area.x + area.w && x[i] + w[i] > area.x && y[i] < area.y + area.h && y[i] + h[i] > area.y)
+				out.push_back(getRect(i));
+		}
+	}
+	
+	/**
+	 * Remove any collectibles touching the rect, returning how many there were
+	 */
+	int collect(SDL_Rect rect) {
+		int collected = 0;
+		for(int i = size() - 1; i >= 0; i--) {
+			if(kind[i] == ENTITY_COLLECTIBLE && x[i] < rect.x + rect.w && x[i] + w[i] > rect.x && y[i] < rect.y + rect.h && y[i] + h[i] > rect.y) {
+				remove(i);
+				collected++;
+			}
+		}
+		return collected;
+	}
+	
+	bool hazardAt(SDL_Rect rect) {
+		for(int i = 0; i < size(); i++) {
+			if(kind[i] == ENTITY_HAZARD && x[i] < rect.x + rect.w && x[i] + w[i] > rect.x && y[i] < rect.y + rect.h && y[i] + h[i] > rect.y)
+				return true;
+		}
+		return false;
+	}
+	
+	/**
+	 * Copy out what the renderer needs, reusing the vectors' space
+	 */
+	void capture(std::vector<SDL_Rect> &rects, std::vector<int> &sprites) {
+		rects.clear();
+		sprites.clear();
+		for(int i = 0; i < size(); i++) {
+			rects.push_back(getRect(i));
+			sprites.push_back(sprite[i]);
+		}
+	}
+};
+
+/**
+ * A level is made in its own arena along with its tiles, tileset, caches and
+ * entity store, so deleting the arena gets rid of all of it at once
+ */
 class GameLevel {
 	private:
+	Arena *arena;
 	MapData *data;
 	std::string filename;
 	SDL_Renderer *renderer;
 	SDL_Texture *bgTex;
 	std::string bg;
 	std::string musicCommand;
+	//made once so entering the level doesn't build it again
+	std::string playCommand;
 	std::string tileset;
 	int tileSize;
 	TilesetDrawer *tilesetDrawer;
-	//command system will be used to go from one level to another
-	std::string leftCommand;
-	std::string rightCommand;
-	std::string upCommand;
-	std::string downCommand;
+	//ids of the levels to go to from each side
+	int id;
+	int left;
+	int right;
+	int up;
+	int down;
+	//what gets spawned each time the level is entered, and what is in it now
+	std::vector<EntitySpawn> spawns;
+	EntityStore *entities;
 	//different coordinates to start at depending on where you enter from
 	int leftCoords[2];
 	int rightCoords[2];
 	int upCoords[2];
 	int downCoords[2];
+	//world levels stream their tiles instead, the simulation around the
+	//player and the renderer around the camera, each into its own window.
+	//The renderer's chunks are read on the job system so drawing never waits on the disk
+	WorldMap *world;
+	WorldStreamer *simWorld;
+	WorldStreamer *drawWorld;
+	//every layer in draw order, with a texture cache for each. A world's
+	//only layer is the collision layer, whose tiles come from drawWorld
+	std::vector<MapLayer> layers;
+	std::vector<LayerCache*> caches;
+	//without a GPU the background and the layers behind the player are drawn
+	//into the canvas on the CPU instead, with the background kept at its size
+	TileAnimations *animations;
+	SoftwareCanvas *canvas;
+	TileSheet *tileSheet;
+	SDL_Surface *bgPixels;
+	
+	/**
+	 * The tiles to draw a layer from
+	 */
+	MapData *drawTiles(int layer) {
+		return drawWorld ? drawWorld->getMap() : layers[layer].tiles;
+	}
 	
 	public:
-	GameLevel(SDL_Renderer *renderer, std::string filename, std::string bg, std::string tileset, int tileSize, std::string musicCommand, int startCoords[4][2], 
-	std::string leftCommand, std::string rightCommand, std::string upCommand, std::string downCommand) {
-		this->filename = filename;
+	GameLevel(Arena *arena, SDL_Renderer *renderer, int id, LevelEntry const &entry, std::string tileset, int tileSize, TileAnimations *animations) {
+		this->arena = arena;
+		this->id = id;
+		this->filename = entry.map;
 		this->renderer = renderer;
-		this->bg = bg;
-		this->musicCommand = musicCommand;
-		this->leftCommand = leftCommand;
-		this->rightCommand = rightCommand;
-		this->upCommand = upCommand;
-		this->downCommand = downCommand;
+		this->bg = entry.background;
+		this->musicCommand = entry.music;
+		this->playCommand = "play " + musicCommand;
+		this->left = entry.exits[0];
+		this->right = entry.exits[1];
+		this->up = entry.exits[2];
+		this->down = entry.exits[3];
 		this->tileset = tileset;
 		this->tileSize = tileSize;
-		this->tilesetDrawer = new TilesetDrawer(tileset, renderer, TILESIZE);
-		leftCoords[0] = startCoords[0][0];
-		leftCoords[1] = startCoords[0][1];
-		rightCoords[0] = startCoords[1][0];
-		rightCoords[1] = startCoords[1][1];
-		upCoords[0] = startCoords[2][0];
-		upCoords[1] = startCoords[2][1];
-		downCoords[0] = startCoords[3][0];
-		downCoords[1] = startCoords[3][1];
-		data = readFile(filename);
+		this->tilesetDrawer = arena->make<TilesetDrawer>(tileset, renderer, TILESIZE);
+		tilesetDrawer->setRemap(animations->getRemap());
+		this->animations = animations;
+		canvas = nullptr;
+		tileSheet = nullptr;
+		bgPixels = nullptr;
+		leftCoords[0] = entry.startCoords[0][0];
+		leftCoords[1] = entry.startCoords[0][1];
+		rightCoords[0] = entry.startCoords[1][0];
+		rightCoords[1] = entry.startCoords[1][1];
+		upCoords[0] = entry.startCoords[2][0];
+		upCoords[1] = entry.startCoords[2][1];
+		downCoords[0] = entry.startCoords[3][0];
+		downCoords[1] = entry.startCoords[3][1];
+		world = nullptr;
+		simWorld = nullptr;
+		drawWorld = nullptr;
+		if(entry.places.empty()) {
+			layers = readLayers(filename, arena);
+			//collision reads its own layer and nothing else
+			for(unsigned int i = 0; i < layers.size(); i++) {
+				if(layers[i].kind == LAYER_COLLISION)
+					data = layers[i].tiles;
+			}
+		}
+		else {
+			world = arena->make<WorldMap>(entry.places);
+			simWorld = arena->make<WorldStreamer>(world);
+			drawWorld = arena->make<WorldStreamer>(world);
+			data = simWorld->getMap();
+			layers.push_back({ LAYER_COLLISION, 1.0f, nullptr });
+		}
+		for(unsigned int i = 0; i < layers.size(); i++) {
+			caches.push_back(arena->make<LayerCache>(renderer, tilesetDrawer, animations));
+		}
+		entities = arena->make<EntityStore>();
+		if(!entry.objects.empty())
+			spawns = readObjects(entry.objects);
+		entities->reserve(spawns.size());
 		//printf("Load BG image '%s': ",bg.c_str());
-		SDL_Surface *bgSurface = IMG_Load(bg.c_str());
-		/*if(!bgSurface)
+		bgTex = loadTexture(renderer, bg);
+		/*if(!bgTex)
 			printf("%s\n",SDL_GetError());
 		else
 			printf("Success\n");*/
-		bgTex = SDL_CreateTextureFromSurface(renderer, bgSurface);
-		SDL_FreeSurface(bgSurface);
 	}
 	~GameLevel() {
+		//everything else is in the arena, which destroys it after this
 		SDL_DestroyTexture(bgTex);
-		delete(tilesetDrawer);
+		if(bgPixels) SDL_FreeSurface(bgPixels);
+	}
+	
+	/**
+	 * Draw the back of the level on the CPU into canvas from now on, or through the renderer again for nullptr
+	 */
+	void setCanvas(SoftwareCanvas *canvas) {
+		this->canvas = canvas;
+		if(canvas && !tileSheet) {
+			tileSheet = arena->make<TileSheet>(tileset, TILESIZE);
+			tileSheet->setRemap(animations->getRemap());
+		}
+	}
+	
+	Arena *getArena() {
+		return arena;
 	}
 	
 	std::string getMusicCommand() {
 		return musicCommand;
 	}
 	
-	std::string getLeft() {
-		return this->leftCommand;
+	int getId() {
+		return id;
 	}
-	std::string getRight() {
-		return this->rightCommand;
+	
+	int getLeft() {
+		return this->left;
 	}
-	std::string getUp() {
-		return this->upCommand;
+	int getRight() {
+		return this->right;
 	}
-	std::string getDown() {
-		return this->downCommand;
+	int getUp() {
+		return this->up;
+	}
+	int getDown() {
+		return this->down;
 	}
 	
 	int getTileSize() {
@@ -98,13 +482,39 @@ class GameLevel {
 	}
 	
 	void setTileSize(int tileSize) {
+		entities->rescale((float)tileSize/this->tileSize);
 		this->tileSize = tileSize;
 	}
 	
+	/**
+	 * The tiles the simulation collides with, just the streamed part for a world
+	 */
 	MapData *getData() {
 		return data;
 	}
 	
+	/**
+	 * Size of the whole level in tiles
+	 */
+	int getW() {
+		return world ? world->getW() : data->getW();
+	}
+	int getH() {
+		return world ? world->getH() : data->getH();
+	}
+	
+	/**
+	 * Keep the simulation's chunks loaded around a world pixel
+	 */
+	void follow(int x, int y) {
+		if(simWorld)
+			simWorld->follow(x, y, tileSize);
+	}
+	
+	EntityStore *getEntities() {
+		return entities;
+	}
+	
 	std::string getFilename() {
 		return filename;
 	}
@@ -112,8 +522,15 @@ class GameLevel {
 	/**
 	 * Load the level by taking the player and setting them, then return music command
 	 */
-	std::string load(Player* player, int side) {
+	std::string const &load(Player* player, int side) {
+		//everything starts over each time the level is entered
+		entities->clear();
+		for(unsigned int i = 0; i < spawns.size(); i++) {
+			entities->spawn(spawns[i], tileSize);
+		}
 		//printf("Loading into level %s with left coords %d,%d\n", filename.c_str(),leftCoords[0],leftCoords[1]);
+		int *coords = side == 0 ? leftCoords : side == 1 ? rightCoords : side == 2 ? upCoords : downCoords;
+		follow(tileSize*coords[0], tileSize*coords[1]);
 		if(side == 0) {
 			player->changeMap(data,tileSize*leftCoords[0],tileSize*leftCoords[1],1);
 		}
@@ -127,15 +544,14 @@ class GameLevel {
 			player->changeMap(data,tileSize*downCoords[0],tileSize*downCoords[1],1);
 		}
 		
-		return "play " + musicCommand;
+		return playCommand;
 	}
 	
-	void draw(Player *player, int width, int height) {
-		//first the background
-		SDL_RenderCopy(renderer, bgTex, NULL, NULL);
-		
+	/**
+	 * Where to draw the level from so the player stays centered without showing past its edges
+	 */
+	void camera(SDL_Rect rect, int width, int height, int *offX, int *offY) {
 		//get the center of where we're drawing
-		SDL_Rect rect = player->getRect();
 		int centerX = rect.x + rect.w/2;
 		int centerY = rect.y + rect.h/2;
 		//where the player will be drawn as percent of screen
@@ -145,32 +561,118 @@ class GameLevel {
 		if(screenPercentX*width - centerX >= 0) {
 			screenPercentX = (double)(centerX%width)/width;
 		}
-		else if(screenPercentX*width + centerX >= tileSize*data->getW()) {
-			screenPercentX = 1.0-(double)(tileSize*data->getW() - centerX)/width;
+		else if(screenPercentX*width + centerX >= tileSize*getW()) {
+			screenPercentX = 1.0-(double)(tileSize*getW() - centerX)/width;
 		}
 		if(screenPercentY*height - centerY >= 0) {
 			screenPercentY = (double)(centerY%height)/height;
 		}
-		else if(screenPercentY*height + centerY >= tileSize*data->getH()) {
-			screenPercentY= 1.0-(double)(tileSize*data->getH() - centerY)/height;
+		else if(screenPercentY*height + centerY >= tileSize*getH()) {
+			screenPercentY= 1.0-(double)(tileSize*getH() - centerY)/height;
 		}
 		//offset drawing everything so that centerX = width/2 and centerY = height/2
-		int offX = width*screenPercentX - centerX;
-		int offY = height*screenPercentY - centerY;
-		
-		int w = data->getW();
-		int h = data->getH();
-		int **dataArr = data->getData();
-		for(int y = 0; y < h; y++) {
-			for(int x = 0; x < w; x++) {
-				tilesetDrawer->draw({offX+tileSize*x,offY+tileSize*y,tileSize,tileSize},dataArr[y][x]);
+		*offX = width*screenPercentX - centerX;
+		*offY = height*screenPercentY - centerY;
+	}
+	
+	/**
+	 * Get the layer caches ready for a snapshot. This switches render targets,
+	 * so it has to happen before anything else is drawn
+	 */
+	void prepare(GameSnapshot const &frame, int width, int height) {
+		if(drawWorld)
+			drawWorld->followAhead(width/2 - frame.offX, height/2 - frame.offY, tileSize);
+		for(unsigned int i = 0; i < layers.size(); i++) {
+			//the canvas draws the layers behind the player every frame, so they aren't cached
+			if(canvas && layers[i].kind != LAYER_FOREGROUND)
+				continue;
+			caches[i]->prepare(drawTiles(i), (int)(frame.offX*layers[i].parallax), (int)(frame.offY*layers[i].parallax), width, height, tileSize);
+		}
+	}
+	
+	/**
+	 * Throw away the cached layers, they get drawn again when next needed
+	 */
+	void invalidate() {
+		for(unsigned int i = 0; i < caches.size(); i++) {
+			caches[i]->invalidate();
+		}
+		if(bgPixels) SDL_FreeSurface(bgPixels);
+		bgPixels = nullptr;
+	}
+	
+	/**
+	 * Fill the canvas with the background, stretched to it the first time
+	 */
+	void drawBackground() {
+		int width = canvas->getW();
+		int height = canvas->getH();
+		if(!bgPixels || bgPixels->w != width || bgPixels->h != height) {
+			if(bgPixels) SDL_FreeSurface(bgPixels);
+			bgPixels = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+			if(!bgPixels) {
+				for(int y = 0; y < height; y++) {
+					std::fill(canvas->getPixels() + y*canvas->getPitch(), canvas->getPixels() + y*canvas->getPitch() + width, 0xFF000000);
+				}
+				return;
+			}
+			SDL_FillRect(bgPixels, NULL, SDL_MapRGBA(bgPixels->format, 0, 0, 0, 255));
+			SDL_Surface *image = decodeImage(bg, SDL_PIXELFORMAT_ARGB8888);
+			if(image) {
+				SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_BLEND);
+				SDL_BlitScaled(image, NULL, bgPixels, NULL);
+				SDL_FreeSurface(image);
+			}
+		}
+		SDL_LockSurface(bgPixels);
+		for(int y = 0; y < height; y++) {
+			memcpy(canvas->getPixels() + y*canvas->getPitch(), (Uint8*)bgPixels->pixels + y*bgPixels->pitch, width*sizeof(Uint32));
+		}
+		SDL_UnlockSurface(bgPixels);
+	}
+	
+	/**
+	 * Draw a snapshot of this level. Only the tiles, which never change during
+	 * play, are read from the level itself
+	 */
+	void draw(GameSnapshot const &frame, Player *player, int width, int height) {
+		int offX = frame.offX;
+		int offY = frame.offY;
+		unsigned int layer = 0;
+		if(canvas && canvas->begin(width, height)) {
+			//on the CPU the background and the layers behind the player all go up in one copy
+			drawBackground();
+			tileSheet->setTileSize(tileSize);
+			for(; layer < layers.size() && layers[layer].kind != LAYER_FOREGROUND; layer++) {
+				tileSheet->drawLayer(canvas, drawTiles(layer), (int)(offX*layers[layer].parallax), (int)(offY*layers[layer].parallax));
+			}
+			canvas->end();
+		}
+		else {
+			//first the background
+			SDL_RenderCopy(renderer, bgTex, NULL, NULL);
+			//background layers and the collision layer go behind everything else
+			for(; layer < layers.size() && layers[layer].kind != LAYER_FOREGROUND; layer++) {
+				caches[layer]->draw(drawTiles(layer), (int)(offX*layers[layer].parallax), (int)(offY*layers[layer].parallax), width, height);
 			}
 		}
+		for(unsigned int i = 0; i < frame.entityRects.size(); i++) {
+			SDL_Rect rect = frame.entityRects[i];
+			rect.x += offX;
+			rect.y += offY;
+			if(rect.x >= width || rect.y >= height || rect.x + rect.w <= 0 || rect.y + rect.h <= 0)
+				continue;
+			tilesetDrawer->draw(rect, frame.entitySprites[i]);
+		}
 		
+		SDL_Rect rect = frame.player;
 		rect.x += offX;
 		rect.y += offY;
-		player->draw(rect);
-		//printf("Player: { %d, %d, %d, %d }\n", player->getRect().x,player->getRect().y,player->getRect().w,player->getRect().h);
+		player->draw(rect, frame.clip, frame.stateTicks, frame.rightFacing);
+		//and foreground layers over the top
+		for(; layer < layers.size(); layer++) {
+			caches[layer]->draw(drawTiles(layer), (int)(offX*layers[layer].parallax), (int)(offY*layers[layer].parallax), width, height);
+		}
 	}
 };
 
@@ -189,20 +691,139 @@ class GameObject : public Visual {
 	int lastSide;
 	//keep a pointer to the save manager so it can modify state
 	LevelState *levelState;
+	//the level is drawn offscreen at whatever resolution keeps frames on time
+	DynamicResolution *scaler;
+	//with no GPU, where the levels draw their backs on the CPU instead
+	SoftwareCanvas *canvas;
+	//platforms near the player this tick
+	std::vector<SDL_Rect> platforms;
+	//collectibles picked up this run
+	int collected;
+	//the simulation runs on its own thread while the game is showing, and
+	//hands each tick to the renderer through the snapshot buffer
+	InputQueue *input;
+	SnapshotBuffer *frames;
+	//shared by every level's tileset, only touched by the renderer
+	TileAnimations *animations;
+	SDL_Thread *simThread;
+	SDL_atomic_t simulating;
+	Uint64 ticks;
+	Uint64 shownTick;
+	int drawnLevel;
+	
+	static int simMain(void *data) {
+		((GameObject*)data)->simLoop();
+		return 0;
+	}
+	
+	/**
+	 * Step on a fixed clock whatever the renderer is doing, so a slow present
+	 * or vsync hiccup never stretches out physics or input
+	 */
+	void simLoop() {
+		Uint64 frequency = SDL_GetPerformanceFrequency();
+		Uint64 step = frequency/SIM_TICKS_PER_SECOND;
+		Uint64 next = SDL_GetPerformanceCounter();
+		while(SDL_AtomicGet(&simulating)) {
+			tick();
+			next += step;
+			Uint64 now = SDL_GetPerformanceCounter();
+			if(now > next + step*SIM_MAX_BEHIND)
+				next = now;
+			else if(next > now)
+				SDL_Delay((next - now)*1000/frequency);
+		}
+	}
+	
+	/**
+	 * One simulation step: this tick's input, then entities, then the player
+	 */
+	void tick() {
+		SDL_Event event;
+		while(input->next(&event, ticks + 1)) {
+			player->handleInput(event);
+		}
+		
+		//a world streams in whatever is around the player before anything moves
+		SDL_Rect rect = player->getRect();
+		currentLevel->follow(rect.x + rect.w/2, rect.y + rect.h/2);
+		
+		//move the entities, taking the player along if they're on a platform
+		EntityStore *entities = currentLevel->getEntities();
+		int tileSize = currentLevel->getTileSize();
+		int under = entities->platformUnder(player->getRect());
+		entities->update(SIM_TICK_MS/1000.0f, currentLevel->getData(), tileSize);
+		if(under >= 0) {
+			int carryX;
+			int carryY;
+			entities->moved(under, &carryX, &carryY);
+			player->carry(carryX, carryY);
+		}
+		//only platforms close enough to be reached this tick get checked against
+		SDL_Rect near = player->getRect();
+		near = { near.x - 4*tileSize, near.y - 4*tileSize, near.w + 8*tileSize, near.h + 8*tileSize };
+		platforms.clear();
+		entities->platformsNear(near, platforms);
+		player->setPlatforms(&platforms);
+		
+		//update the player
+		player->update(SIM_TICK_MS);
+		checkBounds();
+		
+		entities = currentLevel->getEntities();
+		collected += entities->collect(player->getRect());
+		if(entities->hazardAt(player->getRect()))
+			reset();
+		
+		ticks++;
+		publish();
+	}
+	
+	/**
+	 * Copy the state the renderer needs into the free snapshot and hand it over
+	 */
+	void publish() {
+		GameSnapshot *frame = frames->back();
+		frame->tick = ticks;
+		frame->level = currentLevel->getId();
+		frame->player = player->getRect();
+		frame->clip = player->getClip();
+		frame->stateTicks = player->getStateTicks();
+		frame->rightFacing = player->getFacing();
+		currentLevel->camera(frame->player, width, height, &frame->offX, &frame->offY);
+		currentLevel->getEntities()->capture(frame->entityRects, frame->entitySprites);
+		frames->publish();
+	}
 	
 	public:
-	GameObject(SDL_Renderer *renderer, CommandQueue *queuePtr, LevelState *levelState,  int tileSize, int width, int height) {
+	GameObject(SDL_Renderer *renderer, CommandQueue *queuePtr, InputQueue *input, LevelState *levelState, LevelManifest *manifest, SoundBank *sounds, int tileSize, int width, int height) {
 		this->renderer = renderer;
-		//load up all the levels
-		for(int i = 0; i < LEVEL_COUNT; i++) {
-			//printf("Loaded level #%d with left start coords %d,%d\n",i,START_COORDS[i][0][0],START_COORDS[i][0][1]);
-			levels.push_back(new GameLevel(renderer,FILENAMES[i],BACKGROUNDS[i],TILESET,tileSize,MUSIC_NAMES[i],START_COORDS[i],
-								ADJACENT_MAPS[i][0],ADJACENT_MAPS[i][1],ADJACENT_MAPS[i][2],ADJACENT_MAPS[i][3]));
+		this->input = input;
+		this->width = width;
+		this->height = height;
+		frames = new SnapshotBuffer();
+		simThread = nullptr;
+		SDL_AtomicSet(&simulating, 0);
+		ticks = 0;
+		shownTick = 0;
+		drawnLevel = LEVEL_NONE;
+		animations = new TileAnimations(TILE_ANIMATIONS);
+		//load up all the levels, a level's id is its place in the list
+		for(int i = 0; i < manifest->getCount(); i++) {
+			Arena *arena = new Arena();
+			levels.push_back(arena->make<GameLevel>(arena,renderer,i,manifest->get(i),TILESET,tileSize,animations));
 		}
 		this->levelState = levelState;
+		scaler = new DynamicResolution(renderer);
+		canvas = rendersInSoftware(renderer) ? new SoftwareCanvas(renderer) : nullptr;
+		for(unsigned int i = 0; canvas && i < levels.size(); i++) {
+			levels[i]->setCanvas(canvas);
+		}
+		collected = 0;
 		reloadState();
 		//construct the player
 		player = new Player(renderer, 0, 0, nullptr, tileSize);
+		player->setSoundBank(sounds);
 		//load player into level
 		
 		currentLevel->load(player, lastSide);
@@ -210,54 +831,67 @@ class GameObject : public Visual {
 		windowCommandQueue = queuePtr;
 	}
 	~GameObject() {
+		stopSimulation();
+#ifdef TRACK_ALLOCATIONS
+		for(unsigned int i = 0; i < levels.size(); i++) {
+			levels[i]->getArena()->report("Level " + std::to_string(levels[i]->getId()));
+		}
+#endif
 		while(levels.size()) {
-			if(levels.back()) delete(levels.back());
+			if(levels.back()) delete(levels.back()->getArena());
 			levels.pop_back();
 		}
 		delete(player);
+		delete(scaler);
+		delete(canvas);
+		delete(frames);
+		delete(animations);
 	}
 	
-	std::string getTitle() {
-		return "Game";
+	std::string const &getTitle() {
+		return GAME_TITLE;
 	}
 	
 	void reloadState() {
+		//a save from a longer manifest can point past the end
+		if(levelState->getIndex() < 0 || levelState->getIndex() >= (int)levels.size()) {
+			levelState->setIndex(0);
+			levelState->setSide(0);
+		}
 		currentLevel = levels.at(levelState->getIndex());
 		lastSide = levelState->getSide();
 	}
 	
 	void changeTileSize(int tileSize) {
 		player->changeTileSize(tileSize);
-		for(int i = 0; i < LEVEL_COUNT; i++) {
+		for(unsigned int i = 0; i < levels.size(); i++) {
 			levels.at(i)->setTileSize(tileSize);
 		}
 	}
 	
-	bool switchLevel(std::string filename) {
-		if(filename == "win") {
-			endCutscene(renderer);
+	bool switchLevel(int id) {
+		if(id == LEVEL_WIN) {
+			windowCommandQueue->add("show " + END_CUTSCENE);
 			reset();
 		}
-		for(unsigned int i = 0; i<levels.size(); i++) {
-			if(levels.at(i)->getFilename() == filename) {
-				currentLevel = levels.at(i);
-				levelState->setIndex(i);
-				return true;
-			}
-		}
-		return false;
+		if(id < 0 || id >= (int)levels.size())
+			return false;
+		currentLevel = levels[id];
+		levelState->setIndex(id);
+		return true;
 	}
 	
-	//see if the player has moved out of bounds and if so attempt to change level
+	//see if the player has moved out of bounds and if so attempt to change level, autosaving on the way through
 	void checkBounds() {
 		SDL_Rect playerRect = player->getRect();
-		int w = currentLevel->getData()->getW() * currentLevel->getTileSize();
-		int h = currentLevel->getData()->getH() * currentLevel->getTileSize();
+		int w = currentLevel->getW() * currentLevel->getTileSize();
+		int h = currentLevel->getH() * currentLevel->getTileSize();
 		//out of bounds by left of screen
 		if(playerRect.x + playerRect.w < 0) {
 			if(switchLevel(currentLevel->getLeft())) {
 				lastSide = 1;
 				levelState->setSide(lastSide);
+				levelState->save();
 				windowCommandQueue->add(currentLevel->load(player,1));
 			}
 		}
@@ -266,6 +900,7 @@ class GameObject : public Visual {
 			if(switchLevel(currentLevel->getRight())) {
 				lastSide = 0;
 				levelState->setSide(lastSide);
+				levelState->save();
 				windowCommandQueue->add(currentLevel->load(player,0));
 			}
 		}
@@ -274,6 +909,7 @@ class GameObject : public Visual {
 			if(switchLevel(currentLevel->getUp())) {
 				lastSide = 3;
 				levelState->setSide(lastSide);
+				levelState->save();
 				windowCommandQueue->add(currentLevel->load(player,3));
 			}
 			return;
@@ -283,6 +919,7 @@ class GameObject : public Visual {
 			if(switchLevel(currentLevel->getDown())) {
 				lastSide = 2;
 				levelState->setSide(lastSide);
+				levelState->save();
 				windowCommandQueue->add(currentLevel->load(player,2));
 			}
 			else {
@@ -296,32 +933,95 @@ class GameObject : public Visual {
 	}
 	void reset() {
 		currentLevel->load(player,lastSide);
-		player->setState("standing");
+		player->setState(PLAYER_STANDING);
 	}
+	/**
+	 * Nothing to do on the window's thread, the simulation thread steps the game
+	 */
 	void update() {
-		//update the player
-		player->update();
-		checkBounds();
 	}
 	void handleInput(SDL_Event event) {
-		//pass input direct to player
-		player->handleInput(event);
+		//the player takes it on the simulation's next tick
+		input->push(event);
 	}
 	void draw() {
-		//draw the current level, then draw the player
-		currentLevel->draw(player, width, height);
+		//draw whichever tick the simulation finished last
+		GameSnapshot const *frame = frames->latest();
+		if(frame->level < 0)
+			return;
+		//only the level on screen keeps its layers cached
+		if(drawnLevel >= 0 && drawnLevel != frame->level)
+			levels[drawnLevel]->invalidate();
+		drawnLevel = frame->level;
+		animations->update(SDL_GetTicks());
+		levels[frame->level]->prepare(*frame, width, height);
+		//in software, stretching the offscreen target costs more than drawing smaller saves
+		bool scaled = !canvas && scaler->begin();
+		levels[frame->level]->draw(*frame, player, width, height);
+		if(scaled)
+			scaler->end();
+		shownTick = frame->tick;
+	}
+	
+	void invalidate() {
+		for(unsigned int i = 0; i < levels.size(); i++) {
+			levels[i]->invalidate();
+		}
+	}
+	
+	/**
+	 * The tick in the last frame drawn, for timing input through to the screen
+	 */
+	Uint64 getShownTick() {
+		return shownTick;
 	}
 	void resize(int width, int height) {
 		this->width = width;
 		this->height = height;
+		scaler->resize(width, height);
+	}
+	/**
+	 * Join the simulation thread, after which the game is safe to touch from this one
+	 */
+	void stopSimulation() {
+		if(!simThread)
+			return;
+		SDL_AtomicSet(&simulating, 0);
+		SDL_WaitThread(simThread, NULL);
+		simThread = nullptr;
+	}
+	
+	/**
+	 * How long the last frame took against how long it should take, to pick the next frame's resolution
+	 */
+	void frameTime(float ms, float budget) {
+		scaler->frameTime(ms, budget);
 	}
 	
 	std::string onActive() {
 		player->onActive();
+		//the first frame shows where the game picks up, not where it was left
+		publish();
+		if(!simThread) {
+			SDL_AtomicSet(&simulating, 1);
+			simThread = SDL_CreateThread(simMain, "Simulation", this);
+			if(!simThread)
+				printf("Could not start the simulation: %s\n", SDL_GetError());
+		}
 		return "play " + currentLevel->getMusicCommand();
 	}
 	
+	std::string getMusic() {
+		return currentLevel->getMusicCommand();
+	}
+	
 	void onInactive() {
+		stopSimulation();
+		//keys let go before the pause still count, or the player comes back still holding them
+		SDL_Event event;
+		while(input->next(&event, ticks)) {
+			player->handleInput(event);
+		}
 		player->onInactive();
 	}
 	
@@ -359,7 +1059,7 @@ class GameDrawer : public Visual {
 		delete(bg);
 	}
 	
-	std::string getTitle() {
+	std::string const &getTitle() {
 		return this->title;
 	}
 	
@@ -0,0 +1,149 @@
+//Holds game input until the simulation takes it, and times it through to the screen
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+/**
+ * Latency histogram has one bucket per millisecond, the last catches everything longer
+ */
+int const INPUT_LATENCY_BUCKETS = 100;
+int const INPUT_QUEUE_RESERVE = 64;
+
+/**
+ * Every game event is kept in arrival order until the next simulation tick
+ * takes it, so a press and release inside one frame both reach the player.
+ * Once a tick has used an event, its SDL timestamp waits for a frame showing
+ * that tick to be presented and then goes into the histogram. Events come in
+ * on the window's thread and go out on the simulation's, so it all sits behind a lock
+ */
+class InputQueue {
+	private:
+	std::vector<SDL_Event> events;
+	unsigned int read;
+	std::vector<Uint32> awaitingPresent;
+	std::vector<Uint64> awaitingTick;
+	SDL_mutex *lock;
+	Uint32 histogram[INPUT_LATENCY_BUCKETS];
+	Uint64 received;
+	Uint64 delivered;
+	Uint64 discarded;
+	Uint32 worst;
+
+	public:
+	InputQueue() {
+		events.reserve(INPUT_QUEUE_RESERVE);
+		awaitingPresent.reserve(INPUT_QUEUE_RESERVE);
+		awaitingTick.reserve(INPUT_QUEUE_RESERVE);
+		lock = SDL_CreateMutex();
+		read = 0;
+		for(int i = 0; i < INPUT_LATENCY_BUCKETS; i++) {
+			histogram[i] = 0;
+		}
+		received = 0;
+		delivered = 0;
+		discarded = 0;
+		worst = 0;
+	}
+	~InputQueue() {
+		SDL_DestroyMutex(lock);
+	}
+
+	void push(SDL_Event event) {
+		SDL_LockMutex(lock);
+		events.push_back(event);
+		received++;
+		SDL_UnlockMutex(lock);
+	}
+
+	/**
+	 * Next event for the given tick in the order it arrived, false once there are none left
+	 */
+	bool next(SDL_Event *event, Uint64 tick) {
+		SDL_LockMutex(lock);
+		bool found = read < events.size();
+		if(found) {
+			*event = events[read++];
+			awaitingPresent.push_back(event->common.timestamp);
+			awaitingTick.push_back(tick);
+			delivered++;
+		}
+		else {
+			events.clear();
+			read = 0;
+		}
+		SDL_UnlockMutex(lock);
+		return found;
+	}
+
+	/**
+	 * Throw away whatever hasn't been taken, like keys after the game was paused,
+	 * along with the timings of ticks that will never be drawn
+	 */
+	void discard() {
+		SDL_LockMutex(lock);
+		discarded += events.size() - read;
+		events.clear();
+		read = 0;
+		awaitingPresent.clear();
+		awaitingTick.clear();
+		SDL_UnlockMutex(lock);
+	}
+
+	/**
+	 * Call right after a frame is presented, with the last tick it showed
+	 */
+	void presented(Uint64 shownTick) {
+		Uint32 now = SDL_GetTicks();
+		SDL_LockMutex(lock);
+		//ticks only go up, so everything shown is at the front
+		unsigned int shown = 0;
+		while(shown < awaitingTick.size() && awaitingTick[shown] <= shownTick) {
+			Uint32 latency = now - awaitingPresent[shown];
+			worst = latency > worst ? latency : worst;
+			histogram[latency < (Uint32)INPUT_LATENCY_BUCKETS ? latency : INPUT_LATENCY_BUCKETS - 1]++;
+			shown++;
+		}
+		awaitingPresent.erase(awaitingPresent.begin(), awaitingPresent.begin() + shown);
+		awaitingTick.erase(awaitingTick.begin(), awaitingTick.begin() + shown);
+		SDL_UnlockMutex(lock);
+	}
+
+	/**
+	 * Print the counts and latency spread, with how many presses made it within the given frame time
+	 */
+	void report(Uint32 frameMs) {
+		Uint64 measured = 0;
+		Uint64 withinFrame = 0;
+		for(int i = 0; i < INPUT_LATENCY_BUCKETS; i++) {
+			measured += histogram[i];
+			if((Uint32)i <= frameMs)
+				withinFrame += histogram[i];
+		}
+		printf("Input: %llu received, %llu delivered, %llu discarded on pause, %llu lost\n", (unsigned long long)received,
+				(unsigned long long)delivered, (unsigned long long)discarded, (unsigned long long)(received - delivered - discarded - (events.size() - read)));
+		if(!measured)
+			return;
+		Uint64 seen = 0;
+		int median = -1;
+		int p99 = -1;
+		for(int i = 0; i < INPUT_LATENCY_BUCKETS; i++) {
+			seen += histogram[i];
+			if(median < 0 && seen*2 >= measured)
+				median = i;
+			if(p99 < 0 && seen*100 >= measured*99)
+				p99 = i;
+		}
+		printf("Input to present: median %dms, 99th %dms, worst %ums, %.1f%% within %ums\n", median, p99, worst,
+				100.0*withinFrame/measured, frameMs);
+		for(int i = 0; i < INPUT_LATENCY_BUCKETS; i++) {
+			if(histogram[i])
+				printf("  %3d%sms %u\n", i, i == INPUT_LATENCY_BUCKETS - 1 ? "+" : " ", histogram[i]);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,100 @@
+//Times the job system from one thread up to every core on map collision queries
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+#include "GameData.h"
+#include "JobSystem.h"
+
+/**
+ * Work per run, how it is sliced, and how many timed runs to keep the best of
+ */
+int const QUERY_COUNT = 4000000;
+int const QUERY_BATCH = 16384;
+int const TILE_SIZE = 48;
+int const WARMUP_RUNS = 1;
+int const TIMED_RUNS = 5;
+
+struct QueryJob {
+	MapData *map;
+	std::vector<Uint64> hits;
+};
+
+/**
+ * Probe player-sized boxes scattered over the map, the same boxes for the same
+ * index whichever thread gets it, so every thread count has to find the same hits
+ */
+void queryBoxes(void *data, int begin, int end) {
+	QueryJob *job = (QueryJob*)data;
+	int width = job->map->getW()*TILE_SIZE;
+	int height = job->map->getH()*TILE_SIZE;
+	Uint64 hits = 0;
+	for(int i = begin; i < end; i++) {
+		Uint32 seed = (Uint32)i*2654435761u;
+		seed ^= seed >> 15;
+		int x = seed % width;
+		seed = seed*2246822519u + 1;
+		int y = (seed >> 8) % height;
+		hits += job->map->solidColumn(x - 1, y, y + 100, TILE_SIZE);
+		hits += job->map->solidColumn(x + 76, y, y + 100, TILE_SIZE);
+		hits += job->map->solidRow(y - 1, x, x + 75, TILE_SIZE);
+		hits += job->map->solidRow(y + 101, x, x + 75, TILE_SIZE);
+	}
+	job->hits[begin/QUERY_BATCH] = hits;
+}
+
+Uint64 run(QueryJob *job) {
+	JobCounter counter;
+	SDL_AtomicSet(&counter.pending, 0);
+	jobSystem->parallelFor(QUERY_COUNT, QUERY_BATCH, queryBoxes, job, &counter);
+	jobSystem->wait(&counter);
+	Uint64 total = 0;
+	for(unsigned int i = 0; i < job->hits.size(); i++) {
+		total += job->hits[i];
+	}
+	return total;
+}
+
+int main(int argc, char *argv[]) {
+	std::string mapName = argc > 1 ? argv[1] : "Data/Maps/Level1.map";
+	int maxThreads = argc > 2 ? atoi(argv[2]) : SDL_GetCPUCount();
+	maxThreads = maxThreads > 0 ? maxThreads : 1;
+
+	QueryJob job;
+	job.map = readFile(mapName);
+	job.hits.assign((QUERY_COUNT + QUERY_BATCH - 1)/QUERY_BATCH, 0);
+	printf("map %s (%dx%d), %d box queries in slices of %d, best of %d\n", mapName.c_str(), job.map->getW(), job.map->getH(),
+			QUERY_COUNT, QUERY_BATCH, TIMED_RUNS);
+	printf("threads,ms,speedup,efficiency,hits\n");
+
+	double single = 0;
+	Uint64 expected = 0;
+	for(int threads = 1; threads <= maxThreads; threads++) {
+		jobSystem = new JobSystem(threads - 1);
+		Uint64 hits = 0;
+		for(int i = 0; i < WARMUP_RUNS; i++) {
+			hits = run(&job);
+		}
+		double best = 0;
+		for(int i = 0; i < TIMED_RUNS; i++) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			hits = run(&job);
+			double ms = (SDL_GetPerformanceCounter() - start)*1000.0/SDL_GetPerformanceFrequency();
+			best = i == 0 || ms < best ? ms : best;
+		}
+		delete(jobSystem);
+		jobSystem = nullptr;
+		if(threads == 1) {
+			single = best;
+			expected = hits;
+		}
+		printf("%d,%.3f,%.2f,%.2f,%llu\n", threads, best, single/best, single/best/threads, (unsigned long long)hits);
+		if(hits != expected) {
+			printf("Hit count differs from the single thread run, aborting...\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	delete(job.map);
+	return 0;
+}
@@ -0,0 +1,286 @@
+//Small work-stealing job scheduler shared by simulation and loading
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+/**
+ * A job runs function(data, begin, end) over a slice of some range, then
+ * counts its counter down. Anything waiting on the counter goes once it hits zero
+ */
+typedef void (*JobFunction)(void *data, int begin, int end);
+
+struct JobCounter {
+	SDL_atomic_t pending;
+};
+
+struct Job {
+	JobFunction function;
+	void *data;
+	int begin;
+	int end;
+	JobCounter *counter;
+};
+
+int const JOB_QUEUE_RESERVE = 256;
+/**
+ * Queues for threads that aren't workers but submit jobs, like the main and sim threads.
+ * Any past this many share the last one, which its lock keeps safe
+ */
+int const JOB_SUBMITTER_QUEUES = 4;
+
+/**
+ * One worker's jobs. The owner pushes and pops at the back so it keeps working
+ * on what it just split up, thieves take from the front where the biggest,
+ * oldest pieces are
+ */
+class JobQueue {
+	private:
+	std::vector<Job> jobs;
+	unsigned int front;
+	SDL_SpinLock lock;
+
+	public:
+	JobQueue() {
+		jobs.reserve(JOB_QUEUE_RESERVE);
+		front = 0;
+		lock = 0;
+	}
+
+	void push(Job const &job) {
+		SDL_AtomicLock(&lock);
+		//reuse the space in front once it's all been stolen
+		if(front == jobs.size()) {
+			jobs.clear();
+			front = 0;
+		}
+		jobs.push_back(job);
+		SDL_AtomicUnlock(&lock);
+	}
+
+	bool pop(Job *job) {
+		SDL_AtomicLock(&lock);
+		bool found = front < jobs.size();
+		if(found) {
+			*job = jobs.back();
+			jobs.pop_back();
+		}
+		SDL_AtomicUnlock(&lock);
+		return found;
+	}
+
+	bool steal(Job *job) {
+		SDL_AtomicLock(&lock);
+		bool found = front < jobs.size();
+		if(found) {
+			*job = jobs[front++];
+		}
+		SDL_AtomicUnlock(&lock);
+		return found;
+	}
+};
+
+/**
+ * Which queue the current thread owns, and which job system that was in,
+ * since a thread can outlive one and submit to the next
+ */
+static thread_local int jobWorkerIndex = 0;
+static thread_local int jobWorkerSystem = 0;
+static SDL_atomic_t jobSystemCount;
+
+/**
+ * Worker threads plus every thread that submits jobs, each with its own queue.
+ * Nobody blocks waiting on a counter; they run other jobs until it clears, so
+ * nested parallel loops can't deadlock. Workers with nothing to do sleep until
+ * a job is queued, and only as many are woken as there are new jobs
+ */
+class JobSystem {
+	private:
+	std::vector<JobQueue*> queues;
+	std::vector<SDL_Thread*> threads;
+	int workers;
+	int id;
+	SDL_sem *wake;
+	SDL_atomic_t quitting;
+	//jobs in the queues, and workers asleep or about to be that nobody has posted wake for yet
+	SDL_atomic_t queued;
+	SDL_atomic_t idle;
+	SDL_atomic_t submitters;
+
+	struct WorkerStart {
+		JobSystem *system;
+		int index;
+	};
+	std::vector<WorkerStart> starts;
+
+	static int workerMain(void *data) {
+		WorkerStart *start = (WorkerStart*)data;
+		jobWorkerIndex = start->index;
+		jobWorkerSystem = start->system->id;
+		start->system->workerLoop(start->index);
+		return 0;
+	}
+
+	void workerLoop(int index) {
+		while(!SDL_AtomicGet(&quitting)) {
+			if(runOne(index))
+				continue;
+			//count ourselves idle before the last look, so a job queued after it is sure to see us and wake us
+			SDL_AtomicAdd(&idle, 1);
+			if(SDL_AtomicGet(&queued) > 0 && claimIdle())
+				continue;
+			SDL_SemWait(wake);
+		}
+	}
+
+	/**
+	 * Take one idle worker off the count, false if none are left to take
+	 */
+	bool claimIdle() {
+		int count;
+		while((count = SDL_AtomicGet(&idle)) > 0) {
+			if(SDL_AtomicCAS(&idle, count, count - 1))
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Wake one idle worker per new job, as long as there are idle ones
+	 */
+	void wakeWorkers(int jobs) {
+		SDL_AtomicAdd(&queued, jobs);
+		for(int i = 0; i < jobs && claimIdle(); i++) {
+			SDL_SemPost(wake);
+		}
+	}
+
+	void enqueue(JobFunction function, void *data, int begin, int end, JobCounter *counter) {
+		Job job = { function, data, begin, end, counter };
+		if(counter)
+			SDL_AtomicAdd(&counter->pending, 1);
+		queues[ownQueue()]->push(job);
+	}
+
+	/**
+	 * The calling thread's queue, handing out a submitter queue the first time a non-worker asks
+	 */
+	int ownQueue() {
+		if(jobWorkerSystem != id) {
+			int slot = SDL_AtomicAdd(&submitters, 1);
+			jobWorkerIndex = workers + (slot < JOB_SUBMITTER_QUEUES ? slot : JOB_SUBMITTER_QUEUES - 1);
+			jobWorkerSystem = id;
+		}
+		return jobWorkerIndex;
+	}
+
+	/**
+	 * Run a job from our own queue, or failing that one stolen from someone else's
+	 */
+	bool runOne(int index) {
+		Job job;
+		bool found = queues[index]->pop(&job);
+		for(unsigned int i = 1; !found && i < queues.size(); i++) {
+			found = queues[(index + i) % queues.size()]->steal(&job);
+		}
+		if(!found)
+			return false;
+		SDL_AtomicAdd(&queued, -1);
+		job.function(job.data, job.begin, job.end);
+		if(job.counter)
+			SDL_AtomicAdd(&job.counter->pending, -1);
+		return true;
+	}
+
+	public:
+	/**
+	 * workers is the number of extra threads, so 0 runs everything on the thread that waits
+	 */
+	JobSystem(int workers) {
+		SDL_AtomicSet(&quitting, 0);
+		SDL_AtomicSet(&queued, 0);
+		SDL_AtomicSet(&idle, 0);
+		SDL_AtomicSet(&submitters, 0);
+		id = SDL_AtomicAdd(&jobSystemCount, 1) + 1;
+		wake = SDL_CreateSemaphore(0);
+		workers = workers > 0 ? workers : 0;
+		this->workers = workers;
+		//workers own the first queues, submitters the ones after
+		for(int i = 0; i < workers + JOB_SUBMITTER_QUEUES; i++) {
+			queues.push_back(new JobQueue());
+		}
+		starts.resize(workers);
+		for(int i = 0; i < workers; i++) {
+			starts[i].system = this;
+			starts[i].index = i;
+			SDL_Thread *thread = SDL_CreateThread(workerMain, "JobWorker", &starts[i]);
+			if(thread)
+				threads.push_back(thread);
+		}
+	}
+	~JobSystem() {
+		SDL_AtomicSet(&quitting, 1);
+		for(unsigned int i = 0; i < threads.size(); i++) {
+			SDL_SemPost(wake);
+		}
+		for(unsigned int i = 0; i < threads.size(); i++) {
+			SDL_WaitThread(threads[i], NULL);
+		}
+		for(unsigned int i = 0; i < queues.size(); i++) {
+			delete(queues[i]);
+		}
+		SDL_DestroySemaphore(wake);
+	}
+
+	/**
+	 * Threads that can run jobs, counting the one that waits
+	 */
+	int getThreadCount() {
+		return threads.size() + 1;
+	}
+
+	void submit(JobFunction function, void *data, int begin, int end, JobCounter *counter) {
+		enqueue(function, data, begin, end, counter);
+		wakeWorkers(1);
+	}
+
+	/**
+	 * Split 0..count into slices of about batch and queue them all on one counter
+	 */
+	void parallelFor(int count, int batch, JobFunction function, void *data, JobCounter *counter) {
+		batch = batch > 0 ? batch : 1;
+		int jobs = 0;
+		for(int begin = 0; begin < count; begin += batch, jobs++) {
+			enqueue(function, data, begin, begin + batch < count ? begin + batch : count, counter);
+		}
+		wakeWorkers(jobs);
+	}
+
+	/**
+	 * Help out with jobs until the counter clears
+	 */
+	void wait(JobCounter *counter) {
+		while(SDL_AtomicGet(&counter->pending) > 0) {
+			if(!runOne(ownQueue()))
+				SDL_Delay(0);
+		}
+	}
+
+	/**
+	 * Run one waiting job if there is one, for callers that need to do other things while they wait
+	 */
+	bool help() {
+		return runOne(ownQueue());
+	}
+};
+
+/**
+ * The game's scheduler, made in main once SDL is up. Code that can go wide
+ * checks for it and runs everything inline when there isn't one
+ */
+static JobSystem *jobSystem = nullptr;
+
+#endif
@@ -0,0 +1,245 @@
+//Keeps a tile layer drawn into textures a chunk at a time
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <utility>
+#include "SDL2/SDL.h"
+#include "WindowAbstraction.h"
+#include "GameData.h"
+#include "TileAnimation.h"
+
+#ifndef LAYERCACHE_H
+#define LAYERCACHE_H
+
+/**
+ * Cached chunks are square, in tiles. They're kept while within
+ * LAYER_CACHE_MARGIN chunks of the screen so scrolling back doesn't redraw them
+ */
+int const LAYER_CHUNK_TILES = 16;
+int const LAYER_CACHE_MARGIN = 1;
+
+/**
+ * Draws one layer's tiles into a texture per chunk the first time they come
+ * on screen, so after that the layer costs one copy per visible chunk. Chunks
+ * are drawn at the tileset's own tile size and stretched like single tiles
+ * are, which keeps them small. They're keyed by world tile, which stays right
+ * for streamed worlds since a world's tiles never change. Each chunk lists
+ * its animated cells when it's built, and only those get drawn again when
+ * their animation moves on
+ */
+class LayerCache {
+	private:
+	struct CachedChunk {
+		int x;
+		int y;
+		SDL_Texture *texture;
+		//cells as row*LAYER_CHUNK_TILES + column, and the animation version they show
+		std::vector<int> animatedCells;
+		Uint32 version;
+	};
+	SDL_Renderer *renderer;
+	TilesetDrawer *tileset;
+	TileAnimations *animations;
+	std::vector<CachedChunk> chunks;
+	//cell lists of dropped chunks, kept to be filled again so scrolling doesn't allocate
+	std::vector<std::vector<int>> spareCells;
+	int tileSize;
+	//stops trying once render targets turn out not to work
+	bool usable;
+
+	/**
+	 * Chunks any part of which is on screen, clipped to the tiles there are
+	 */
+	bool visibleChunks(MapData *tiles, int offX, int offY, int width, int height, int *x0, int *y0, int *x1, int *y1) {
+		int left = std::max(floorDivide(-offX, tileSize), tiles->getOriginX());
+		int top = std::max(floorDivide(-offY, tileSize), tiles->getOriginY());
+		int right = std::min(floorDivide(width - 1 - offX, tileSize), tiles->getOriginX() + tiles->getW() - 1);
+		int bottom = std::min(floorDivide(height - 1 - offY, tileSize), tiles->getOriginY() + tiles->getH() - 1);
+		*x0 = floorDivide(left, LAYER_CHUNK_TILES);
+		*y0 = floorDivide(top, LAYER_CHUNK_TILES);
+		*x1 = floorDivide(right, LAYER_CHUNK_TILES);
+		*y1 = floorDivide(bottom, LAYER_CHUNK_TILES);
+		return left <= right && top <= bottom;
+	}
+
+	int find(int x, int y) {
+		for(unsigned int i = 0; i < chunks.size(); i++) {
+			if(chunks[i].x == x && chunks[i].y == y)
+				return i;
+		}
+		return -1;
+	}
+
+	/**
+	 * Draw a chunk's tiles at the given size, with the chunk's top left corner at x, y
+	 */
+	void drawTiles(MapData *tiles, int cx, int cy, int x, int y, int tileSize) {
+		int **data = tiles->getData();
+		for(int j = 0; j < LAYER_CHUNK_TILES; j++) {
+			int row = cy*LAYER_CHUNK_TILES + j - tiles->getOriginY();
+			if(row < 0 || row >= tiles->getH())
+				continue;
+			for(int i = 0; i < LAYER_CHUNK_TILES; i++) {
+				int column = cx*LAYER_CHUNK_TILES + i - tiles->getOriginX();
+				if(column >= 0 && column < tiles->getW())
+					tileset->draw({ x + tileSize*i, y + tileSize*j, tileSize, tileSize }, data[row][column]);
+			}
+		}
+	}
+
+	SDL_Texture *build(MapData *tiles, int cx, int cy) {
+		int side = LAYER_CHUNK_TILES*tileset->tileSize();
+		SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, side, side);
+		SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+		if(!texture || SDL_SetRenderTarget(renderer, texture) != 0) {
+			printf("No render targets for tile layers, drawing them tile by tile: %s\n", SDL_GetError());
+			if(texture) SDL_DestroyTexture(texture);
+			usable = false;
+			return nullptr;
+		}
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		SDL_RenderClear(renderer);
+		drawTiles(tiles, cx, cy, 0, 0, tileset->tileSize());
+		SDL_SetRenderTarget(renderer, previous);
+		return texture;
+	}
+	
+	void findAnimated(MapData *tiles, CachedChunk &chunk) {
+		chunk.version = animations ? animations->getVersion() : 0;
+		int **data = tiles->getData();
+		for(int j = 0; animations && j < LAYER_CHUNK_TILES; j++) {
+			int row = chunk.y*LAYER_CHUNK_TILES + j - tiles->getOriginY();
+			for(int i = 0; row >= 0 && row < tiles->getH() && i < LAYER_CHUNK_TILES; i++) {
+				int column = chunk.x*LAYER_CHUNK_TILES + i - tiles->getOriginX();
+				if(column >= 0 && column < tiles->getW() && animations->isAnimated(data[row][column]))
+					chunk.animatedCells.push_back(j*LAYER_CHUNK_TILES + i);
+			}
+		}
+	}
+	
+	/**
+	 * Draw again just the cells whose animation has moved on since the chunk was last brought up to date
+	 */
+	void animate(MapData *tiles, CachedChunk &chunk) {
+		SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+		if(SDL_SetRenderTarget(renderer, chunk.texture) != 0)
+			return;
+		SDL_BlendMode blend;
+		SDL_GetRenderDrawBlendMode(renderer, &blend);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		int **data = tiles->getData();
+		int side = tileset->tileSize();
+		for(unsigned int i = 0; i < chunk.animatedCells.size(); i++) {
+			int cell = chunk.animatedCells[i];
+			int column = cell%LAYER_CHUNK_TILES;
+			int row = cell/LAYER_CHUNK_TILES;
+			int tile = data[chunk.y*LAYER_CHUNK_TILES + row - tiles->getOriginY()][chunk.x*LAYER_CHUNK_TILES + column - tiles->getOriginX()];
+			if(!animations->changedSince(tile, chunk.version))
+				continue;
+			SDL_Rect rect = { column*side, row*side, side, side };
+			//clear the old frame out rather than blending over it
+			SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+			SDL_RenderFillRect(renderer, &rect);
+			SDL_SetRenderDrawBlendMode(renderer, blend);
+			tileset->draw(rect, tile);
+		}
+		SDL_SetRenderTarget(renderer, previous);
+		chunk.version = animations->getVersion();
+	}
+
+	public:
+	LayerCache(SDL_Renderer *renderer, TilesetDrawer *tileset, TileAnimations *animations) {
+		this->renderer = renderer;
+		this->tileset = tileset;
+		this->animations = animations;
+		tileSize = 0;
+		usable = true;
+	}
+	~LayerCache() {
+		invalidate();
+	}
+
+	/**
+	 * Draw whatever chunks are about to come on screen and drop ones well off
+	 * it. Call with nothing else targeted, before drawing the frame
+	 */
+	void prepare(MapData *tiles, int offX, int offY, int width, int height, int tileSize) {
+		this->tileSize = tileSize;
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+		if(!visibleChunks(tiles, offX, offY, width, height, &x0, &y0, &x1, &y1))
+			return;
+		for(unsigned int i = 0; i < chunks.size();) {
+			CachedChunk const &chunk = chunks[i];
+			if(chunk.x < x0 - LAYER_CACHE_MARGIN || chunk.x > x1 + LAYER_CACHE_MARGIN
+				|| chunk.y < y0 - LAYER_CACHE_MARGIN || chunk.y > y1 + LAYER_CACHE_MARGIN) {
+				SDL_DestroyTexture(chunk.texture);
+				spareCells.push_back(std::move(chunks[i].animatedCells));
+				spareCells.back().clear();
+				chunks[i] = std::move(chunks.back());
+				chunks.pop_back();
+				continue;
+			}
+			i++;
+		}
+		for(int cy = y0; usable && cy <= y1; cy++) {
+			for(int cx = x0; usable && cx <= x1; cx++) {
+				int index = find(cx, cy);
+				if(index >= 0) {
+					//chunks off screen catch up when they come back on
+					CachedChunk &chunk = chunks[index];
+					if(chunk.animatedCells.size() && chunk.version != animations->getVersion())
+						animate(tiles, chunk);
+					continue;
+				}
+				SDL_Texture *texture = build(tiles, cx, cy);
+				if(!texture)
+					continue;
+				chunks.push_back({ cx, cy, texture, std::vector<int>(), 0 });
+				if(spareCells.size()) {
+					chunks.back().animatedCells.swap(spareCells.back());
+					spareCells.pop_back();
+				}
+				findAnimated(tiles, chunks.back());
+			}
+		}
+	}
+
+	/**
+	 * Copy the visible chunks to the screen, drawing any that aren't cached tile by tile
+	 */
+	void draw(MapData *tiles, int offX, int offY, int width, int height) {
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+		if(!tileSize || !visibleChunks(tiles, offX, offY, width, height, &x0, &y0, &x1, &y1))
+			return;
+		int side = LAYER_CHUNK_TILES*tileSize;
+		for(int cy = y0; cy <= y1; cy++) {
+			for(int cx = x0; cx <= x1; cx++) {
+				int index = find(cx, cy);
+				SDL_Rect rect = { offX + cx*side, offY + cy*side, side, side };
+				if(index >= 0)
+					SDL_RenderCopy(renderer, chunks[index].texture, NULL, &rect);
+				else
+					drawTiles(tiles, cx, cy, rect.x, rect.y, tileSize);
+			}
+		}
+	}
+
+	/**
+	 * Throw every chunk away, for when render targets lose their contents or the level is left
+	 */
+	void invalidate() {
+		for(unsigned int i = 0; i < chunks.size(); i++) {
+			SDL_DestroyTexture(chunks[i].texture);
+		}
+		chunks.clear();
+	}
+};
+
+#endif
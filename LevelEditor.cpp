@@ -2,9 +2,11 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
 #include "SDL2/SDL_ttf.h"
+#include "FloodFill.h"
 
 /**
  * Store the coordinates of the mouse pointer
@@ -28,6 +30,16 @@ std::string const FONT_NAME = "Assets/TTF/Ubuntu-R.ttf";
  * The default folder to save levels
  */
  std::string const DEFAULT_DIRECTORY = "Maps/";
+/**
+ * Map layers, matching GameData.h. A map with just a collision layer is saved
+ * the old way so maps that never had layers stay the same
+ */
+int const MAP_LAYERS_MARKER = -1;
+int const LAYER_BACKGROUND = 0;
+int const LAYER_COLLISION = 1;
+int const LAYER_FOREGROUND = 2;
+std::string const LAYER_KIND_NAMES[3] = { "background", "collision", "foreground" };
+int const PARALLAX_STEP = 10;
 
 //Visual output
 //-------------------------------------------------------------------------
@@ -320,55 +332,25 @@ class MapData {
 	}
 };
 
+/**
+ * A layer as it is in the file, parallax in hundredths
+ */
+struct MapLayer {
+	int kind;
+	int parallax;
+	MapData *data;
+};
+
+/**
+ * Put the layers in the order the game draws them: backgrounds, collision, then foregrounds
+ */
+void sortLayers(std::vector<MapLayer> &layers) {
+	std::stable_sort(layers.begin(), layers.end(), [](MapLayer const &a, MapLayer const &b) { return a.kind < b.kind; });
+}
+
 void floodFill(MapData *mapData, int x, int y, int newValue) {
 	//printf("Fill called with value=%d\n",newValue);
-	if(x < 0 || y < 0 || x>=mapData->getW() || y>=mapData->getH()) {
-		return;
-	}
-	
-	int w = mapData->getW();
-	int h = mapData->getH();
-	int oldValue = mapData->getData()[y][x];
-	int **data = mapData->getData();
-	data[y][x] = -2;
-	
-	bool changed = true;
-	while(changed) {
-		changed = false;
-		for(int y = 0; y < h; y++) {
-			for(int x = 0; x < w; x++) {
-				if(data[y][x] == oldValue) {
-					if(x>0 && data[y][x-1] == -2) {
-						data[y][x] = -2;
-						changed = true;
-						continue;
-					}
-					if(x<w-1 && data[y][x+1] == -2) {
-						data[y][x] = -2;
-						changed = true;
-						continue;
-					}
-					if(y>0 && data[y-1][x] == -2) {
-						data[y][x] = -2;
-						changed = true;
-						continue;
-					}
-					if(y<h-1 && data[y+1][x] == -2) {
-						data[y][x] = -2;
-						changed = true;
-						continue;
-					}
-				}
-			}
-		}
-	}
-	for(int y = 0; y < h; y++) {
-		for(int x = 0; x < w; x++) {
-			if(data[y][x] == -2) {
-				data[y][x] = newValue;
-			}
-		}
-	}
+	floodFill(mapData->getData(), mapData->getW(), mapData->getH(), x, y, newValue);
 }
 
 /**
@@ -378,9 +360,12 @@ class WindowManager {
 	private:
 	std::vector<SpecificTile*> tilesetTiles;
 	std::vector<SpecificTile*> mapTiles;
+	//the layers under the one being edited, drawn beneath it
+	std::vector<SpecificTile*> underTiles;
 	SpecificElement *sidePanel;
 	SpecificElement *background;
 	SpecificElement *activeText;
+	SpecificElement *layerText;
 	SpecificTile *activeTile;
 	SDL_Renderer *renderer;
 	int activeIndex;
@@ -389,18 +374,29 @@ class WindowManager {
 	int mapTileSize;
 	int mapW;
 	MapData *data;
+	std::vector<MapLayer> *layers;
+	int activeLayer;
 	bool lmbDown;
 	
 	public:
-	WindowManager(SDL_Renderer *renderer, std::string tilesetName, int tilesize, MapData *data) {
+	WindowManager(SDL_Renderer *renderer, std::string tilesetName, int tilesize, std::vector<MapLayer> *layers) {
 		this->renderer = renderer;
 		sidePanel = NULL;
 		background = NULL;
+		activeText = NULL;
+		layerText = NULL;
 		activeIndex = -1;
 		this->tileset = new TilesetDrawer(tilesetName, renderer, tilesize);
 		tileSize = tileset->tileSize();
 		mapTileSize = tileSize;
-		this->data = data;
+		this->layers = layers;
+		//start on the collision layer
+		activeLayer = 0;
+		for(unsigned int i = 0; i < layers->size(); i++) {
+			if(layers->at(i).kind == LAYER_COLLISION)
+				activeLayer = i;
+		}
+		this->data = layers->at(activeLayer).data;
 		mapW = 1;
 		lmbDown = false;
 		build();
@@ -419,9 +415,14 @@ class WindowManager {
 			if(mapTiles.back()) delete(mapTiles.back());
 			mapTiles.pop_back();
 		}
+		while(underTiles.size()) {
+			if(underTiles.back()) delete(underTiles.back());
+			underTiles.pop_back();
+		}
 		if(sidePanel) delete(sidePanel);
 		if(background) delete(background);
 		if(activeText) delete(activeText);
+		if(layerText) delete(layerText);
 	}
 	
 	/**
@@ -448,6 +449,11 @@ class WindowManager {
 		//build the active text/tile
 		activeText = new SpecificElement(new TextTile("Active Element:", renderer), {0,(int)14.5*SCREEN_HEIGHT/16,SCREEN_WIDTH/8,SCREEN_WIDTH/24});
 		activeTile = new SpecificTile(tileset,{SCREEN_WIDTH/8 + (SCREEN_WIDTH/8-SCREEN_HEIGHT/16)/2,7*SCREEN_HEIGHT/8, SCREEN_HEIGHT/16,SCREEN_HEIGHT/16},activeIndex);
+		//and which layer is being edited
+		MapLayer const &layer = layers->at(activeLayer);
+		std::string layerName = "Layer " + std::to_string(activeLayer + 1) + "/" + std::to_string(layers->size()) + ": "
+								+ LAYER_KIND_NAMES[layer.kind] + " x" + std::to_string(layer.parallax/100) + "." + std::to_string(layer.parallax/10%10);
+		layerText = new SpecificElement(new TextTile(layerName, renderer), {0,(int)13.5*SCREEN_HEIGHT/16,SCREEN_WIDTH/4,SCREEN_WIDTH/32});
 		//construct the map
 		int mapH = data->getH();
 		mapW = data->getW();
@@ -462,6 +468,15 @@ class WindowManager {
 				mapTiles.push_back(new SpecificTile(tileset, { (x*(mapTileSize))+horiOffset, (y*(mapTileSize))+vertOffset, mapTileSize, mapTileSize }, data[y][x]));
 			}
 		}
+		for(int i = 0; i < activeLayer; i++) {
+			int **under = layers->at(i).data->getData();
+			for(int y = 0; y < mapH; y++) {
+				for(int x = 0; x < mapW; x++) {
+					if(under[y][x] >= 0)
+						underTiles.push_back(new SpecificTile(tileset, { (x*(mapTileSize))+horiOffset, (y*(mapTileSize))+vertOffset, mapTileSize, mapTileSize }, under[y][x]));
+				}
+			}
+		}
 	}
 	
 	/**
@@ -478,10 +493,14 @@ class WindowManager {
 		}
 		//then draw active tile
 		activeText->draw();
+		layerText->draw();
 		if(activeIndex >= 0) {
 			activeTile->draw();
 		}
-		//then draw map
+		//then draw map, the layers below first
+		for(unsigned int i = 0; i < underTiles.size(); i++) {
+			underTiles.at(i)->draw();
+		}
 		for(unsigned int i = 0; i < mapTiles.size(); i++) {
 			mapTiles.at(i)->draw();
 			//then draw grid over top
@@ -535,6 +554,62 @@ class WindowManager {
 				build();
 			}
 		}
+		/**
+		 * Layers: tab moves to the next, N adds an empty one above the current,
+		 * delete removes it, K switches it between background and foreground,
+		 * and [ and ] change how fast it scrolls. The collision layer always stays
+		 */
+		if(event.type == SDL_KEYDOWN) {
+			MapLayer &layer = layers->at(activeLayer);
+			bool changed = true;
+			switch(event.key.keysym.sym) {
+				case SDLK_TAB:
+					activeLayer = (activeLayer + 1) % layers->size();
+					break;
+				case SDLK_n:
+					layers->insert(layers->begin() + activeLayer + 1,
+									{ layer.kind == LAYER_BACKGROUND ? LAYER_BACKGROUND : LAYER_FOREGROUND, 100, new MapData(data->getW(), data->getH()) });
+					activeLayer++;
+					for(int y = 0; y < data->getH(); y++) {
+						std::fill(layers->at(activeLayer).data->getData()[y], layers->at(activeLayer).data->getData()[y] + data->getW(), -1);
+					}
+					break;
+				case SDLK_DELETE:
+					if(layer.kind == LAYER_COLLISION)
+						break;
+					delete(layer.data);
+					layers->erase(layers->begin() + activeLayer);
+					activeLayer -= activeLayer > 0;
+					break;
+				case SDLK_k: {
+					if(layer.kind == LAYER_COLLISION)
+						break;
+					layer.kind = layer.kind == LAYER_BACKGROUND ? LAYER_FOREGROUND : LAYER_BACKGROUND;
+					//move it to where the game will draw it, and keep editing it there
+					MapData *editing = layer.data;
+					sortLayers(*layers);
+					for(unsigned int i = 0; i < layers->size(); i++) {
+						if(layers->at(i).data == editing)
+							activeLayer = i;
+					}
+					break;
+				}
+				case SDLK_LEFTBRACKET:
+					if(layer.kind != LAYER_COLLISION && layer.parallax >= PARALLAX_STEP)
+						layer.parallax -= PARALLAX_STEP;
+					break;
+				case SDLK_RIGHTBRACKET:
+					if(layer.kind != LAYER_COLLISION)
+						layer.parallax += PARALLAX_STEP;
+					break;
+				default:
+					changed = false;
+			}
+			if(changed) {
+				data = layers->at(activeLayer).data;
+				build();
+			}
+		}
 		/**
 		 * Quit if window is closed
 		 */
@@ -650,47 +725,86 @@ void getInfo(std::string *input, int *width, int *height, std::string *tileset,
 	clear();
 }
 
-MapData *readFile(std::string filename) {
+/**
+ * Read every layer of a map, old maps being a single collision layer
+ */
+std::vector<MapLayer> readFile(std::string filename) {
 	FILE *fp = fopen(filename.c_str(), "r");
 	if(!fp) {
 		throw;
 	}
+	std::vector<MapLayer> layers;
+	int count = 1;
 	int w = getw(fp);
+	bool layered = w == MAP_LAYERS_MARKER;
+	if(layered) {
+		count = getw(fp);
+		w = getw(fp);
+	}
 	int h = getw(fp);
 	//printf("Loading file: %d x %d\n",w, h);
-	MapData *data = new MapData(w, h);
-	int **theData = data->getData();
-	for(int y = 0; y < h; y++) {
-		for(int x = 0; x < w; x++) {
-			theData[y][x] = getw(fp);
+	bool collision = false;
+	for(int i = 0; i < count; i++) {
+		MapLayer layer = { LAYER_COLLISION, 100, new MapData(w, h) };
+		if(layered) {
+			layer.kind = getw(fp);
+			layer.parallax = getw(fp);
+		}
+		//the same as the game reads it, only one layer collides and damaged kinds are foregrounds
+		layer.kind = layer.kind < 0 || layer.kind > LAYER_FOREGROUND || (layer.kind == LAYER_COLLISION && collision) ? LAYER_FOREGROUND : layer.kind;
+		collision = collision || layer.kind == LAYER_COLLISION;
+		int **theData = layer.data->getData();
+		for(int y = 0; y < h; y++) {
+			for(int x = 0; x < w; x++) {
+				theData[y][x] = getw(fp);
+			}
 		}
+		layers.push_back(layer);
 	}
+	fclose(fp);
+	if(!collision && !layers.empty())
+		layers[0].kind = LAYER_COLLISION;
+	sortLayers(layers);
 	
-	return data;
+	return layers;
 }
 
 /**
- * Write the file as a bunch of ints. Width, then height, then each row left to right
+ * Write the file as a bunch of ints. Width, then height, then each row left to right.
+ * Maps with more than a collision layer start with MAP_LAYERS_MARKER and the
+ * layer count, and give each layer's kind and parallax before its rows
  */
-void writeFile(std::string filename, MapData *data) {
+void writeFile(std::string filename, std::vector<MapLayer> const &layers) {
 	FILE *fp = fopen(filename.c_str(), "w");
 	if(!fp) {
 		throw new std::exception;
 	}
-	putw(data->getW(), fp);
-	putw(data->getH(), fp);
-	int **theData = data->getData();
-	for(int y = 0; y < data->getH(); y++) {
-		for(int x = 0; x < data->getW(); x++) {
-			putw(theData[y][x], fp);
+	bool layered = layers.size() > 1 || layers.at(0).kind != LAYER_COLLISION || layers.at(0).parallax != 100;
+	if(layered) {
+		putw(MAP_LAYERS_MARKER, fp);
+		putw(layers.size(), fp);
+	}
+	putw(layers.at(0).data->getW(), fp);
+	putw(layers.at(0).data->getH(), fp);
+	for(unsigned int i = 0; i < layers.size(); i++) {
+		if(layered) {
+			putw(layers[i].kind, fp);
+			putw(layers[i].parallax, fp);
+		}
+		int **theData = layers[i].data->getData();
+		for(int y = 0; y < layers[i].data->getH(); y++) {
+			for(int x = 0; x < layers[i].data->getW(); x++) {
+				putw(theData[y][x], fp);
+			}
 		}
 	}
+	fclose(fp);
 }
 
 /**
  * Use CLI to prompt user for output filename, then save the map data
  */
-void saveFile(MapData *data) {
+void saveFile(std::vector<MapLayer> const &layers) {
 	std::string outputFilename = "";
 	while(outputFilename == "") {
 		printf("Output file name?: ");
@@ -724,7 +838,7 @@ void saveFile(MapData *data) {
 		std::string newfilename(filename);
 		outputFilename = newfilename;
 		try {
-			writeFile(outputFilename, data);
+			writeFile(outputFilename, layers);
 		} catch (std::exception e) {
 			outputFilename = "";
 			printf("Failed to write to file.");
@@ -745,16 +859,15 @@ int main() {
 	int tilesize;
 	getInfo(&input, &width, &height, &tileset, &tilesize);
 	setWindowTitle(input);
-	MapData *mapData = NULL;
+	std::vector<MapLayer> layers;
 	if(input == "") {
-		mapData = new MapData(width, height);
+		layers.push_back({ LAYER_COLLISION, 100, new MapData(width, height) });
 	}
 	else {
 		try {
-			mapData = readFile(input);
+			layers = readFile(input);
 		} catch(std::exception e) {
 			printf("Could not read input file, aborting...");
-			delete(mapData);
 			exit(EXIT_FAILURE);
 		}
 	}
@@ -769,7 +882,7 @@ int main() {
 	SDL_Renderer *renderer  = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
 	SDL_SetRenderDrawBlendMode(renderer,SDL_BLENDMODE_BLEND);
 	SDL_Event event;
-	WindowManager *windowManager = new WindowManager(renderer, tileset, tilesize, mapData);
+	WindowManager *windowManager = new WindowManager(renderer, tileset, tilesize, &layers);
 	
 	//main loop
 	bool run = true;
@@ -788,11 +901,13 @@ int main() {
 	SDL_Quit();
 	
 	//save file
-	saveFile(mapData);
+	saveFile(layers);
 	
 	//garbage collect
 	delete(windowManager);
-	delete(mapData);
+	for(unsigned int i = 0; i < layers.size(); i++) {
+		delete(layers[i].data);
+	}
 	
 	//and done
 	return 0;
@@ -6,14 +6,31 @@
 #ifndef LEVELINFO_H
 #define LEVELINFO_H
 
-int const LEVEL_COUNT = 9;
 int const TILESIZE = 16;
-std::string FILENAMES[LEVEL_COUNT] = { "Data/Maps/Level1.map", "Data/Maps/Level2.map", "Data/Maps/Level3.map", "Data/Maps/Level4.map", "Data/Maps/Level5.map", "Data/Maps/Level6.map", "Data/Maps/Level7.map", "Data/Maps/Level8.map", "Data/Maps/Level9.map"  };
-std::string BACKGROUNDS[LEVEL_COUNT] = { "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3 Sunset.png", "Assets/Image/Clouds 3 Sunset.png", "Assets/Image/Clouds 3 Sunset.png", "Assets/Image/Clouds 3 Sunset.png" };
 std::string TILESET = "Assets/Image/metroidvania.png";
-std::string MUSIC_NAMES[LEVEL_COUNT] = { "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/TowardsTheSummit.ogg", "Assets/Sound/TowardsTheSummit.ogg", "Assets/Sound/TowardsTheSummit.ogg", "Assets/Sound/TowardsTheSummit.ogg" };
-int START_COORDS[LEVEL_COUNT][4][2] = { { { 3, 10 }, { 48, 21 }, { 21, 0 }, { 0, 0 } }, 
-										{ { 1, 52 }, { 0, 0 }, { 21, 0 }, { 0, 0 } }, 
+
+/**
+ * Exit targets that aren't levels
+ */
+int const LEVEL_NONE = -1;
+int const LEVEL_WIN = -2;
+int const LEVEL_UNKNOWN = -3;
+
+/**
+ * The shipped campaign, built in when compiled with BUILTIN_LEVELS instead of
+ * read from Data/Levels.manifest, so keep the two in step. Sides are ordered
+ * left, right, up, down, and an exit is a level name, "win", or "" for nothing.
+ * The arrays are left unsized so a missing row is a build error rather than an empty level
+ */
+int const LEVEL_COUNT = 9;
+constexpr char const *LEVEL_NAMES[] = { "Level1", "Level2", "Level3", "Level4", "Level5", "Level6", "Level7", "Level8", "Level9" };
+constexpr char const *FILENAMES[] = { "Data/Maps/Level1.map", "Data/Maps/Level2.map", "Data/Maps/Level3.map", "Data/Maps/Level4.map", "Data/Maps/Level5.map", "Data/Maps/Level6.map", "Data/Maps/Level7.map", "Data/Maps/Level8.map", "Data/Maps/Level9.map"  };
+constexpr char const *BACKGROUNDS[] = { "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3.png", "Assets/Image/Clouds 3 Sunset.png", "Assets/Image/Clouds 3 Sunset.png", "Assets/Image/Clouds 3 Sunset.png", "Assets/Image/Clouds 3 Sunset.png" };
+constexpr char const *MUSIC_NAMES[] = { "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/JourneyAhead.ogg", "Assets/Sound/TowardsTheSummit.ogg", "Assets/Sound/TowardsTheSummit.ogg", "Assets/Sound/TowardsTheSummit.ogg", "Assets/Sound/TowardsTheSummit.ogg" };
+//entities to spawn in each level, "" for none
+constexpr char const *OBJECT_LISTS[] = { "Data/Objects/Level1.objects", "", "", "", "", "", "", "", "" };
+constexpr int START_COORDS[][4][2] = { { { 3, 10 }, { 48, 21 }, { 21, 0 }, { 0, 0 } },
+										{ { 1, 52 }, { 0, 0 }, { 21, 0 }, { 0, 0 } },
 										{ { 1, 7 }, { 28, 10 }, { 0, 0 }, { 15, 13 } },
 										{ { 0, 0 }, { 38, 18 }, { 0, 0 }, { 0, 0 } },
 										{ { 0, 0 }, { 0, 0 }, { 19, 0 }, { 0, 0 } },
@@ -21,14 +38,71 @@ int START_COORDS[LEVEL_COUNT][4][2] = { { { 3, 10 }, { 48, 21 }, { 21, 0 }, { 0,
 										{ { 0, 0 }, { 0, 0 }, { 10, 0 }, { 0, 0 } },
 										{ { 0, 0 }, { 68, 4 }, { 0, 0 }, { 8, 26 } },
 										{ { 0, 48 }, { 0, 0 }, { 0, 0 }, { 0, 0 } } };
-std::string ADJACENT_MAPS[LEVEL_COUNT][4] = { { "", "Data/Maps/Level2.map", "", "" }, 
-											{ "Data/Maps/Level1.map", "", "Data/Maps/Level3.map", "" }, 
-											{ "Data/Maps/Level4.map", "Data/Maps/Level6.map", "", "Data/Maps/Level2.map" },
-											{ "", "Data/Maps/Level3.map", "", "Data/Maps/Level5.map" },
-											{ "", "", "", "Data/Maps/Level1.map" },
-											{ "Data/Maps/Level3.map", "", "Data/Maps/Level8.map", "Data/Maps/Level7.map" },
-											{ "", "", "Data/Maps/Level6.map", "" },
-											{ "", "Data/Maps/Level9.map", "", "Data/Maps/Level6.map" },
+constexpr char const *ADJACENT_MAPS[][4] = { { "", "Level2", "", "" },
+											{ "Level1", "", "Level3", "" },
+											{ "Level4", "Level6", "", "Level2" },
+											{ "", "Level3", "", "Level5" },
+											{ "", "", "", "Level1" },
+											{ "Level3", "", "Level8", "Level7" },
+											{ "", "", "Level6", "" },
+											{ "", "Level9", "", "Level6" },
 											{ "", "", "win", "" }  };
+//exits with no way back, as { level, side }
+constexpr int ONE_WAY_EXITS[][2] = { { 3, 3 }, { 4, 3 }, { 7, 1 } };
+
+static_assert(sizeof(LEVEL_NAMES)/sizeof(LEVEL_NAMES[0]) == LEVEL_COUNT, "LEVEL_NAMES needs one entry per level");
+static_assert(sizeof(FILENAMES)/sizeof(FILENAMES[0]) == LEVEL_COUNT, "FILENAMES needs one entry per level");
+static_assert(sizeof(BACKGROUNDS)/sizeof(BACKGROUNDS[0]) == LEVEL_COUNT, "BACKGROUNDS needs one entry per level");
+static_assert(sizeof(MUSIC_NAMES)/sizeof(MUSIC_NAMES[0]) == LEVEL_COUNT, "MUSIC_NAMES needs one entry per level");
+static_assert(sizeof(OBJECT_LISTS)/sizeof(OBJECT_LISTS[0]) == LEVEL_COUNT, "OBJECT_LISTS needs one entry per level");
+static_assert(sizeof(START_COORDS)/sizeof(START_COORDS[0]) == LEVEL_COUNT, "START_COORDS needs one entry per level");
+static_assert(sizeof(ADJACENT_MAPS)/sizeof(ADJACENT_MAPS[0]) == LEVEL_COUNT, "ADJACENT_MAPS needs one entry per level");
+
+//single-return recursion keeps these valid C++11 constexpr
+constexpr bool sameName(char const *a, char const *b) {
+	return *a == *b && (*a == '\0' || sameName(a + 1, b + 1));
+}
+
+constexpr int findCampaignLevel(char const *name, int id = 0) {
+	return id == LEVEL_COUNT ? LEVEL_UNKNOWN : sameName(LEVEL_NAMES[id], name) ? id : findCampaignLevel(name, id + 1);
+}
+
+constexpr int campaignExit(int level, int side) {
+	return ADJACENT_MAPS[level][side][0] == '\0' ? LEVEL_NONE
+		: sameName(ADJACENT_MAPS[level][side], "win") ? LEVEL_WIN
+		: findCampaignLevel(ADJACENT_MAPS[level][side]);
+}
+
+constexpr bool isOneWay(int level, int side, int i = 0) {
+	return i < (int)(sizeof(ONE_WAY_EXITS)/sizeof(ONE_WAY_EXITS[0]))
+		&& ((ONE_WAY_EXITS[i][0] == level && ONE_WAY_EXITS[i][1] == side) || isOneWay(level, side, i + 1));
+}
+
+//exits are walked as one flat list, level i/4 and side i%4
+constexpr bool exitsNameLevels(int i = 0) {
+	return i == 4*LEVEL_COUNT || (campaignExit(i/4, i%4) != LEVEL_UNKNOWN && exitsNameLevels(i + 1));
+}
+
+//left and right pair up as sides 0 and 1, up and down as 2 and 3
+constexpr bool exitLeadsBack(int level, int side) {
+	return campaignExit(level, side) < 0 || isOneWay(level, side)
+		|| campaignExit(campaignExit(level, side), side ^ 1) == level;
+}
+
+constexpr bool exitsLeadBack(int i = 0) {
+	return i == 4*LEVEL_COUNT || (exitLeadsBack(i/4, i%4) && exitsLeadBack(i + 1));
+}
+
+static_assert(exitsNameLevels(), "ADJACENT_MAPS names a level that isn't in LEVEL_NAMES");
+static_assert(exitsLeadBack(), "an exit in ADJACENT_MAPS has no way back and isn't listed in ONE_WAY_EXITS");
+
+/**
+ * Exits resolved to level ids at compile time
+ */
+#define CAMPAIGN_EXIT_ROW(level) { campaignExit(level, 0), campaignExit(level, 1), campaignExit(level, 2), campaignExit(level, 3) }
+constexpr int CAMPAIGN_EXITS[][4] = { CAMPAIGN_EXIT_ROW(0), CAMPAIGN_EXIT_ROW(1), CAMPAIGN_EXIT_ROW(2), CAMPAIGN_EXIT_ROW(3), CAMPAIGN_EXIT_ROW(4),
+									CAMPAIGN_EXIT_ROW(5), CAMPAIGN_EXIT_ROW(6), CAMPAIGN_EXIT_ROW(7), CAMPAIGN_EXIT_ROW(8) };
+#undef CAMPAIGN_EXIT_ROW
+static_assert(sizeof(CAMPAIGN_EXITS)/sizeof(CAMPAIGN_EXITS[0]) == LEVEL_COUNT, "CAMPAIGN_EXITS needs one row per level");
 
 #endif
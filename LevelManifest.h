@@ -0,0 +1,190 @@
+//The list of levels and how they connect, loaded at startup
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include "AssetPack.h"
+#include "LevelInfo.h"
+#include "WorldMap.h"
+
+#ifndef LEVELMANIFEST_H
+#define LEVELMANIFEST_H
+
+std::string const LEVEL_MANIFEST = "Data/Levels.manifest";
+
+std::string const LEVEL_WIN_NAME = "win";
+std::string const LEVEL_NONE_NAME = "-";
+
+/**
+ * Everything needed to build one level. Sides are ordered left, right, up, down
+ * for both the start coordinates and the exits, which are already level ids
+ */
+struct LevelEntry {
+	std::string name;
+	std::string map;
+	std::string background;
+	std::string music;
+	std::string objects;
+	int startCoords[4][2];
+	int exits[4];
+	//maps laid out as one streamed world instead of a single map, in world tiles
+	std::vector<MapPlacement> places;
+};
+
+/**
+ * Levels in file order, so a level's id is its position in the manifest and
+ * saves keep pointing at the same level as long as new ones go on the end.
+ *
+ * Each level is a block of lines:
+ *   level <name>
+ *   map <path>
+ *   background <path>
+ *   music <path>
+ *   objects <path>      (optional, see readObjects)
+ *   start <left x y> <right x y> <up x y> <down x y>
+ *   exits <left> <right> <up> <down>
+ * where an exit is another level's name, "win", or "-" for nothing
+ */
+class LevelManifest {
+	private:
+	std::vector<LevelEntry> levels;
+	std::unordered_map<std::string, int> ids;
+
+	/**
+	 * Split "keyword value" and drop trailing whitespace, the value may have spaces in it
+	 */
+	static bool splitLine(char *line, std::string &keyword, std::string &value) {
+		int end = strlen(line);
+		while(end > 0 && isspace((unsigned char)line[end - 1]))
+			line[--end] = '\0';
+		char *space = strchr(line, ' ');
+		if(!space || line[0] == '#')
+			return false;
+		keyword.assign(line, space - line);
+		while(*space == ' ')
+			space++;
+		value = space;
+		return true;
+	}
+
+	public:
+	/**
+	 * The campaign compiled into LevelInfo.h, exits already resolved
+	 */
+	LevelManifest() {
+		for(int i = 0; i < LEVEL_COUNT; i++) {
+			LevelEntry entry;
+			entry.name = LEVEL_NAMES[i];
+			entry.map = FILENAMES[i];
+			entry.background = BACKGROUNDS[i];
+			entry.music = MUSIC_NAMES[i];
+			entry.objects = OBJECT_LISTS[i];
+			memcpy(entry.startCoords, START_COORDS[i], sizeof(entry.startCoords));
+			memcpy(entry.exits, CAMPAIGN_EXITS[i], sizeof(entry.exits));
+			ids[entry.name] = i;
+			levels.push_back(entry);
+		}
+	}
+	
+	LevelManifest(std::string filename) {
+		char *text = loadText(filename);
+		if(!text) {
+			printf("Could not load level manifest '%s'\n", filename.c_str());
+			throw;
+		}
+		//exits can name levels further down, so keep the names until every level is known
+		std::vector<std::string> exitNames;
+		char *cursor = text;
+		char *line;
+		std::string keyword;
+		std::string value;
+		while((line = nextLine(&cursor))) {
+			if(!splitLine(line, keyword, value))
+				continue;
+			if(keyword == "level") {
+				LevelEntry entry;
+				entry.name = value;
+				memset(entry.startCoords, 0, sizeof(entry.startCoords));
+				for(int i = 0; i < 4; i++) {
+					entry.exits[i] = LEVEL_NONE;
+					exitNames.push_back(LEVEL_NONE_NAME);
+				}
+				if(ids.count(value))
+					printf("Level '%s' is in the manifest twice\n", value.c_str());
+				ids[value] = levels.size();
+				levels.push_back(entry);
+				continue;
+			}
+			if(levels.empty())
+				continue;
+			LevelEntry &entry = levels.back();
+			if(keyword == "map") {
+				entry.map = value;
+			}
+			else if(keyword == "background") {
+				entry.background = value;
+			}
+			else if(keyword == "music") {
+				entry.music = value;
+			}
+			else if(keyword == "objects") {
+				entry.objects = value;
+			}
+			else if(keyword == "place") {
+				MapPlacement place;
+				int length = 0;
+				if(sscanf(value.c_str(), "%d %d %n", &place.x, &place.y, &length) < 2 || !value[length]) {
+					printf("Level '%s' has a place line without x, y and a map\n", entry.name.c_str());
+					continue;
+				}
+				place.map = value.substr(length);
+				entry.places.push_back(place);
+			}
+			else if(keyword == "start") {
+				int *coords = &entry.startCoords[0][0];
+				sscanf(value.c_str(), "%d %d %d %d %d %d %d %d", &coords[0], &coords[1], &coords[2], &coords[3], &coords[4], &coords[5], &coords[6], &coords[7]);
+			}
+			else if(keyword == "exits") {
+				char names[4][64] = { { 0 } };
+				sscanf(value.c_str(), "%63s %63s %63s %63s", names[0], names[1], names[2], names[3]);
+				for(int i = 0; i < 4; i++) {
+					exitNames[4*(levels.size() - 1) + i] = names[i][0] ? names[i] : LEVEL_NONE_NAME;
+				}
+			}
+		}
+		SDL_free(text);
+
+		for(unsigned int i = 0; i < levels.size(); i++) {
+			for(int side = 0; side < 4; side++) {
+				std::string const &name = exitNames[4*i + side];
+				if(name == LEVEL_WIN_NAME) {
+					levels[i].exits[side] = LEVEL_WIN;
+				}
+				else if(name != LEVEL_NONE_NAME) {
+					levels[i].exits[side] = find(name);
+					if(levels[i].exits[side] == LEVEL_NONE)
+						printf("Level '%s' exits to unknown level '%s'\n", levels[i].name.c_str(), name.c_str());
+				}
+			}
+		}
+	}
+
+	/**
+	 * Id of a level by name, LEVEL_NONE if there isn't one
+	 */
+	int find(std::string const &name) {
+		std::unordered_map<std::string, int>::const_iterator it = ids.find(name);
+		return it == ids.end() ? LEVEL_NONE : it->second;
+	}
+
+	int getCount() {
+		return levels.size();
+	}
+
+	LevelEntry const &get(int id) {
+		return levels.at(id);
+	}
+};
+
+#endif
@@ -2,58 +2,178 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <cstring>
+#include "SDL2/SDL.h"
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 #ifndef LEVELSTATE_H
 #define LEVELSTATE_H
 
+/**
+ * Save file record. The checksum covers every field before it, so a torn or
+ * corrupted file is noticed instead of loading a garbage level index
+ */
+char const SAVE_MAGIC[4] = { 'O', 'T', 'C', 'S' };
+Uint32 const SAVE_VERSION = 1;
+
+struct SaveRecord {
+	char magic[4];
+	Uint32 version;
+	Sint32 index;
+	Sint32 side;
+	Uint32 checksum;
+};
+
+Uint32 crc32(void const *data, size_t length) {
+	Uint8 const *bytes = (Uint8 const*)data;
+	Uint32 crc = 0xFFFFFFFF;
+	for(size_t i = 0; i < length; i++) {
+		crc ^= bytes[i];
+		for(int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+Uint32 saveChecksum(SaveRecord const &record) {
+	return crc32(&record, offsetof(SaveRecord, checksum));
+}
+
 class LevelState {
 	private:
 	int index;
 	int side;
 	bool fileExists;
 	std::string filename;
+	//the writer thread takes the latest request, so several saves in a row only write once
+	SDL_Thread *writer;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	bool pendingWrite;
+	bool pendingRemove;
+	bool quitting;
+	SaveRecord pendingRecord;
 	
-	void saveFile() {
-		FILE *fp = fopen(filename.c_str(), "w");
-		//nice and simple file structure
-		putw(index,fp);
-		putw(side,fp);
-		fclose(fp);
-		fileExists = true;
+	static int writerMain(void *data) {
+		((LevelState*)data)->writerLoop();
+		return 0;
+	}
+	
+	void writerLoop() {
+		SDL_LockMutex(lock);
+		while(true) {
+			if(pendingRemove) {
+				pendingRemove = false;
+				SDL_UnlockMutex(lock);
+				remove(filename.c_str());
+				SDL_LockMutex(lock);
+			}
+			else if(pendingWrite) {
+				SaveRecord record = pendingRecord;
+				pendingWrite = false;
+				SDL_UnlockMutex(lock);
+				saveFile(record);
+				SDL_LockMutex(lock);
+			}
+			else if(quitting) {
+				break;
+			}
+			else {
+				SDL_CondWait(wake, lock);
+			}
+		}
+		SDL_UnlockMutex(lock);
+	}
+	
+	/**
+	 * Write to a temporary file, flush it to disk, then rename over the old
+	 * save, so a crash at any point leaves either the old save or the new one
+	 */
+	bool saveFile(SaveRecord record) {
+		std::string temp = filename + ".tmp";
+		FILE *fp = fopen(temp.c_str(), "wb");
+		if(!fp) {
+			printf("Could not write save '%s'\n", temp.c_str());
+			return false;
+		}
+		bool ok = fwrite(&record, sizeof(record), 1, fp) == 1 && fflush(fp) == 0;
+#ifdef _WIN32
+		ok = ok && _commit(_fileno(fp)) == 0;
+#else
+		ok = ok && fsync(fileno(fp)) == 0;
+#endif
+		ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+		ok = ok && MoveFileExA(temp.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		ok = ok && rename(temp.c_str(), filename.c_str()) == 0;
+#endif
+		if(!ok) {
+			printf("Could not write save '%s'\n", filename.c_str());
+			remove(temp.c_str());
+		}
+		return ok;
 	}
 	
 	bool loadFile() {
-		FILE *fp = fopen(filename.c_str(), "r");
+		FILE *fp = fopen(filename.c_str(), "rb");
 		if(!fp) {
 			return false;
 		}
-		else {
-			index = getw(fp);
-			side = getw(fp);
-			fclose(fp);
+		SaveRecord record;
+		size_t read = fread(&record, 1, sizeof(record), fp);
+		fclose(fp);
+		//saves from before the record format were just the two ints
+		if(read == 2*sizeof(int) && memcmp(record.magic, SAVE_MAGIC, 4)) {
+			int legacy[2];
+			memcpy(legacy, &record, sizeof(legacy));
+			index = legacy[0];
+			side = legacy[1];
 			return true;
 		}
+		if(read != sizeof(record) || memcmp(record.magic, SAVE_MAGIC, 4) || record.version != SAVE_VERSION
+		|| record.checksum != saveChecksum(record)) {
+			printf("Save '%s' is damaged, ignoring it\n", filename.c_str());
+			return false;
+		}
+		index = record.index;
+		side = record.side;
+		return true;
 	}
 	
 	public:
 	LevelState(std::string filename) {
 		this->filename = filename;
-		//try to load the file from the given filename
-		FILE *fp = fopen(filename.c_str(), "r");
-		if(!fp) {
-			//on failure, default to 0,0
+		//try to load the file from the given filename, on failure default to 0,0
+		index = 0;
+		side = 0;
+		fileExists = loadFile();
+		if(!fileExists) {
 			index = 0;
 			side = 0;
-			fileExists = false;
-		}
-		else {
-			fclose(fp);
-			loadFile();
-			fileExists = true;
 		}
+		pendingWrite = false;
+		pendingRemove = false;
+		quitting = false;
+		lock = SDL_CreateMutex();
+		wake = SDL_CreateCond();
+		writer = SDL_CreateThread(writerMain, "SaveWriter", this);
 	}
 	~LevelState() {
 		save();
+		SDL_LockMutex(lock);
+		quitting = true;
+		SDL_CondSignal(wake);
+		SDL_UnlockMutex(lock);
+		SDL_WaitThread(writer, NULL);
+		SDL_DestroyCond(wake);
+		SDL_DestroyMutex(lock);
 	}
 	
 	int getIndex() {
@@ -71,15 +191,43 @@ class LevelState {
 	void setSide(int newSide) {
 		side = newSide;
 	}
+	/**
+	 * Hand the current state to the writer thread, returns straight away
+	 */
 	void save() {
-		saveFile();
+		SaveRecord record;
+		memcpy(record.magic, SAVE_MAGIC, 4);
+		record.version = SAVE_VERSION;
+		record.index = index;
+		record.side = side;
+		record.checksum = saveChecksum(record);
+		SDL_LockMutex(lock);
+		pendingRecord = record;
+		pendingWrite = true;
+		pendingRemove = false;
+		SDL_CondSignal(wake);
+		SDL_UnlockMutex(lock);
+		fileExists = true;
+		//no thread means no background writes, so just do it now
+		if(!writer) {
+			pendingWrite = false;
+			saveFile(record);
+		}
 	}
 	void deleteSave() {
 		index = 0;
 		side = 0;
-		//remove file if it exists
-		remove(filename.c_str());
+		//remove file if it exists, after any save still waiting to be written
+		SDL_LockMutex(lock);
+		pendingWrite = false;
+		pendingRemove = true;
+		SDL_CondSignal(wake);
+		SDL_UnlockMutex(lock);
 		fileExists = false;
+		if(!writer) {
+			pendingRemove = false;
+			remove(filename.c_str());
+		}
 	}
 };
 
@@ -0,0 +1,165 @@
+//Bundles Assets/ and Data/ into one pack file for the game to map at startup
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "SDL2/SDL.h"
+#include "AssetPack.h"
+
+/**
+ * Folders that get packed, and files inside them that must stay loose
+ */
+std::string const PACK_FOLDERS[] = { "Assets", "Data" };
+std::string const SKIP_EXTENSIONS[] = { ".sav" };
+/**
+ * Default alignment for each file's data, overridable from the command line
+ */
+Uint32 const DEFAULT_ALIGNMENT = 16;
+
+bool endsWith(std::string text, std::string ending) {
+	return text.length() >= ending.length() && text.compare(text.length() - ending.length(), ending.length(), ending) == 0;
+}
+
+/**
+ * Collect every regular file under a folder, paths relative to the game directory
+ */
+void listFiles(std::string folder, std::vector<std::string> *files) {
+	DIR *dir = opendir(folder.c_str());
+	if(!dir) {
+		printf("Cannot open folder '%s', skipping\n", folder.c_str());
+		return;
+	}
+	struct dirent *item;
+	while((item = readdir(dir))) {
+		std::string name = item->d_name;
+		if(name == "." || name == "..")
+			continue;
+		std::string path = folder + "/" + name;
+		struct stat info;
+		if(stat(path.c_str(), &info) != 0)
+			continue;
+		if(S_ISDIR(info.st_mode)) {
+			listFiles(path, files);
+		}
+		else if(S_ISREG(info.st_mode)) {
+			bool skip = false;
+			for(std::string const &extension : SKIP_EXTENSIONS) {
+				if(endsWith(path, extension))
+					skip = true;
+			}
+			if(!skip)
+				files->push_back(path);
+		}
+	}
+	closedir(dir);
+}
+
+bool readWhole(std::string path, std::vector<Uint8> *out) {
+	FILE *fp = fopen(path.c_str(), "rb");
+	if(!fp)
+		return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	out->resize(size);
+	bool ok = size == 0 || fread(&out->at(0), 1, size, fp) == (size_t)size;
+	fclose(fp);
+	return ok;
+}
+
+Uint32 alignUp(Uint32 offset, Uint32 alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char *argv[]) {
+	std::string output = argc > 1 ? argv[1] : PACK_FILENAME;
+	Uint32 alignment = argc > 2 ? atoi(argv[2]) : DEFAULT_ALIGNMENT;
+	if(alignment < 1) {
+		printf("Invalid alignment, aborting...\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	//sorted by byte value, which is the order the game binary searches in
+	std::vector<std::string> files;
+	for(std::string const &folder : PACK_FOLDERS) {
+		listFiles(folder, &files);
+	}
+	std::sort(files.begin(), files.end());
+	
+	//read everything, keeping the compressed copy only where it actually helps
+	std::vector<std::vector<Uint8> > contents(files.size());
+	std::vector<PackEntry> entries(files.size());
+	Uint32 nameOffset = sizeof(PackHeader) + files.size()*sizeof(PackEntry);
+	for(unsigned int i = 0; i < files.size(); i++) {
+		std::vector<Uint8> data;
+		if(!readWhole(files.at(i), &data)) {
+			printf("Cannot read '%s', aborting...\n", files.at(i).c_str());
+			exit(EXIT_FAILURE);
+		}
+		PackEntry &entry = entries.at(i);
+		entry.nameOffset = nameOffset;
+		entry.nameLength = files.at(i).length();
+		entry.size = data.size();
+		entry.flags = 0;
+		nameOffset += entry.nameLength;
+		std::vector<Uint8> packed = packCompress(data.empty() ? NULL : &data[0], data.size());
+		if(packed.size() < data.size() - data.size()/8) {
+			entry.flags |= PACK_COMPRESSED;
+			contents.at(i).swap(packed);
+		}
+		else {
+			contents.at(i).swap(data);
+		}
+		entry.storedSize = contents.at(i).size();
+	}
+	
+	//lay the data out after the names
+	Uint32 dataOffset = nameOffset;
+	for(unsigned int i = 0; i < entries.size(); i++) {
+		dataOffset = alignUp(dataOffset, alignment);
+		entries.at(i).dataOffset = dataOffset;
+		dataOffset += entries.at(i).storedSize;
+	}
+	
+	FILE *fp = fopen(output.c_str(), "wb");
+	if(!fp) {
+		printf("Cannot open '%s' for writing, aborting...\n", output.c_str());
+		exit(EXIT_FAILURE);
+	}
+	PackHeader header;
+	memcpy(header.magic, PACK_MAGIC, 4);
+	header.version = PACK_VERSION;
+	header.count = entries.size();
+	header.alignment = alignment;
+	fwrite(&header, sizeof(header), 1, fp);
+	if(!entries.empty())
+		fwrite(&entries[0], sizeof(PackEntry), entries.size(), fp);
+	for(unsigned int i = 0; i < files.size(); i++) {
+		fwrite(files.at(i).c_str(), 1, files.at(i).length(), fp);
+	}
+	Uint32 written = nameOffset;
+	Uint32 sizeTotal = 0;
+	for(unsigned int i = 0; i < entries.size(); i++) {
+		static Uint8 const padding[256] = { 0 };
+		while(written < entries.at(i).dataOffset) {
+			Uint32 gap = entries.at(i).dataOffset - written;
+			gap = gap > sizeof(padding) ? sizeof(padding) : gap;
+			fwrite(padding, 1, gap, fp);
+			written += gap;
+		}
+		if(!contents.at(i).empty())
+			fwrite(&contents.at(i)[0], 1, contents.at(i).size(), fp);
+		written += contents.at(i).size();
+		sizeTotal += entries.at(i).size;
+		printf("%s%s: %u -> %u\n", files.at(i).c_str(), entries.at(i).flags & PACK_COMPRESSED ? " (compressed)" : "", entries.at(i).size, entries.at(i).storedSize);
+	}
+	if(fclose(fp) != 0) {
+		printf("Failed to write '%s'\n", output.c_str());
+		exit(EXIT_FAILURE);
+	}
+	printf("Packed %u files, %u bytes into %u bytes in '%s'\n", (Uint32)files.size(), sizeTotal, written, output.c_str());
+	
+	return 0;
+}
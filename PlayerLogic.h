@@ -7,6 +7,9 @@
 #include "SDL2/SDL_ttf.h"
 #include "SDL2/SDL_mixer.h"
 #include "GameData.h"
+#include "SpriteAtlas.h"
+#include "Animation.h"
+#include "Audio.h"
 
 
 #ifndef PLAYERLOGIC_H
@@ -33,6 +36,40 @@ static bool rightDown;
 static bool downDown;
 
 std::string const SPRITE_DIRECTORY = "Assets/Image/Character/";
+std::string const SPRITE_EXTENSION = ".png";
+std::string const ANIMATION_FILE = "Data/Animations/Player.anim";
+
+/**
+ * Every Player draws from the same clips and atlas, built by whichever one is made first
+ */
+static AnimationSet *playerAnimations = nullptr;
+static SpriteAtlas *playerAtlas = nullptr;
+static int playerAtlasUsers = 0;
+
+/**
+ * Sound effects the player triggers, by name in the sound bank
+ */
+int const PLAYER_SOUND_COUNT = 3;
+std::string const PLAYER_SOUND_NAMES[PLAYER_SOUND_COUNT] = { "footstep", "jump", "glide" };
+int const SOUND_FOOTSTEP = 0;
+int const SOUND_JUMP = 1;
+int const SOUND_GLIDE = 2;
+
+/**
+ * The simulation ticks at the rate the player's physics were tuned for
+ */
+int const SIM_TICKS_PER_SECOND = 60;
+double const SIM_TICK_MS = 1000.0/SIM_TICKS_PER_SECOND;
+
+/**
+ * What the player can be doing, states switch by these rather than by name
+ */
+int const PLAYER_STANDING = 0;
+int const PLAYER_CROUCHING = 1;
+int const PLAYER_RUNNING = 2;
+int const PLAYER_SLIDING = 3;
+int const PLAYER_JUMPING = 4;
+int const PLAYER_GLIDING = 5;
 
 class Player {
 	private:
@@ -48,9 +85,11 @@ class Player {
 		MapData *map;
 		int tileSize;
 		double factor;
+		std::vector<SDL_Rect> const *platforms;
 		
 		public:
 		PlayerCollider(int xpos, int ypos, Player *parent, MapData *map, int tileSize) {
+			platforms = nullptr;
 			xvel = 0;
 			yvel = 0;
 			xacc = 0;
@@ -124,6 +163,13 @@ class Player {
 			unsigned int elapsedTime = SDL_GetTicks() - lastTime;
 			elapsedTime -= parent->readInactiveTime();
 			lastTime = SDL_GetTicks();
+			update(elapsedTime);
+		}
+		
+		/**
+		 * Move on by a given number of milliseconds, whatever the clock says
+		 */
+		void update(double elapsedTime) {
 			yvel += gravity*(double)elapsedTime/1000.0;
 			xvel -= xacc*(double)elapsedTime/1000.0;
 			if(yvel > MAX_YVEL)
@@ -136,18 +182,7 @@ class Player {
 			int xMov = factor*xvel*(double)elapsedTime/1000.0;
 			//left:
 			while(xMov < 0) {
-				bool collision = false;
-				int x = rect.x-1;
-				for(int y = rect.y; y < rect.y+rect.h; y += tileSize) {
-					if(checkCollision(x,y)) {
-						collision = true;
-						break;
-					}
-				}
-				int y = rect.y+rect.h;
-				if(checkCollision(x,y)) {
-						collision = true;
-				}
+				bool collision = checkColumn(rect.x-1, rect.y, rect.y+rect.h);
 				if(collision) {
 					parent->onCollideLeft();
 					break;
@@ -159,18 +194,7 @@ class Player {
 			}
 			//right:
 			while(xMov > 0) {
-				bool collision = false;
-				int x = rect.x+rect.w+1;
-				for(int y = rect.y; y < rect.y+rect.h; y += tileSize) {
-					if(checkCollision(x,y)) {
-						collision = true;
-						break;
-					}
-				}
-				int y = rect.y+rect.h;
-				if(checkCollision(x,y)) {
-						collision = true;
-				}
+				bool collision = checkColumn(rect.x+rect.w+1, rect.y, rect.y+rect.h);
 				if(collision) {
 					parent->onCollideRight();
 					break;
@@ -184,18 +208,7 @@ class Player {
 			int yMov = factor*yvel*(double)elapsedTime/1000.0;
 			//up:
 			while(yMov < 0) {
-				bool collision = false;
-				int y = rect.y-1;
-				for(int x = rect.x; x < rect.x+rect.w; x += tileSize) {
-					if(checkCollision(x,y)) {
-						collision = true;
-						break;
-					}
-				}
-				int x = rect.x+rect.w;
-				if(checkCollision(x,y)) {
-						collision = true;
-				}
+				bool collision = checkRow(rect.y-1, rect.x, rect.x+rect.w);
 				if(collision) {
 					parent->onCollideTop();
 					break;
@@ -208,18 +221,7 @@ class Player {
 			//down:
 			bool collidedBottom = false;
 			while(yMov >= 0) {
-				bool collision = false;
-				int y = rect.y+rect.h+1;
-				for(int x = rect.x; x < rect.x+rect.w; x += tileSize) {
-					if(checkCollision(x,y)) {
-						collision = true;
-						break;
-					}
-				}
-				int x = rect.x+rect.w;
-				if(checkCollision(x,y)) {
-						collision = true;
-				}
+				bool collision = checkRow(rect.y+rect.h+1, rect.x, rect.x+rect.w);
 				if(collision) {
 					parent->onCollideBottom();
 					collidedBottom = true;
@@ -239,6 +241,43 @@ class Player {
 			return map->valueAtPoint(x, y, tileSize) != -1;
 		}
 		
+		/**
+		 * Tiles first, then any solid entities the game has handed over
+		 */
+		bool checkColumn(int x, int top, int bottom) {
+			if(map->solidColumn(x, top, bottom, tileSize))
+				return true;
+			for(unsigned int i = 0; platforms && i < platforms->size(); i++) {
+				SDL_Rect const &p = (*platforms)[i];
+				if(x >= p.x && x < p.x + p.w && bottom >= p.y && top < p.y + p.h)
+					return true;
+			}
+			return false;
+		}
+		
+		bool checkRow(int y, int left, int right) {
+			if(map->solidRow(y, left, right, tileSize))
+				return true;
+			for(unsigned int i = 0; platforms && i < platforms->size(); i++) {
+				SDL_Rect const &p = (*platforms)[i];
+				if(y >= p.y && y < p.y + p.h && right >= p.x && left < p.x + p.w)
+					return true;
+			}
+			return false;
+		}
+		
+		void setPlatforms(std::vector<SDL_Rect> const *platforms) {
+			this->platforms = platforms;
+		}
+		
+		/**
+		 * Move along with whatever is being stood on
+		 */
+		void shift(int dx, int dy) {
+			rect.x += dx;
+			rect.y += dy;
+		}
+		
 		void clearYVel() {
 			yvel = 0;
 		}
@@ -256,11 +295,7 @@ class Player {
 	class PlayerState {
 		protected:
 		std::string filename;
-		std::string extension;
-		int frames;
-		int framerate;
-		std::vector<SDL_Texture*> textures;
-		SDL_Renderer *renderer;
+		int clip;
 		Player *parent;
 		
 		public:
@@ -273,24 +308,16 @@ class Player {
 			return filename;
 		}
 		
+		int getClip() {
+			return clip;
+		}
+		
 		void draw(SDL_Rect rect) {
-			//first find which frame of the animation to draw
-			unsigned int index = 0;
-			if(framerate) {
-				unsigned int currentTime = SDL_GetTicks();
-				unsigned int pointInCurrentSecond = currentTime % 1000;
-				index = pointInCurrentSecond / (1000/framerate);
-			}
-			//cut down to the right amount of frames
-			index = index % frames;
-			//then verify that there are enough frames loaded
-			index = index < textures.size() ? index : 0;
+			//first find which frame of the animation to draw from time spent in this state
+			int index = parent->getAnimations()->frameAt(clip, parent->getStateTicks());
 			
-			//finally render the texture
-			if(parent->getFacing())
-				SDL_RenderCopyEx(renderer, textures.at(index), NULL, &rect, 0, NULL, SDL_FLIP_HORIZONTAL);
-			else
-				SDL_RenderCopy(renderer, textures.at(index), NULL, &rect);
+			//then render it, using the pre-mirrored copy when facing right
+			parent->getAtlas()->draw(rect, clip, index, parent->getFacing());
 		}
 		
 		virtual void onCollideFront() {
@@ -322,24 +349,10 @@ class Player {
 	};
 	class StandingState : public PlayerState {
 		public:
-		StandingState(SDL_Renderer *renderer, Player *parent) {
+		StandingState(Player *parent) {
 			filename = "standing";
-			extension = ".png";
-			frames = 1;
-			framerate = 0;
-			this->renderer = renderer;
+			clip = parent->getAnimations()->findClip(filename);
 			this->parent = parent;
-			for(int i = 0; i < frames; i++) {
-				SDL_Surface *surface = IMG_Load((SPRITE_DIRECTORY + filename + std::to_string(i) + extension).c_str());
-				textures.push_back(SDL_CreateTextureFromSurface(renderer,surface));
-				SDL_FreeSurface(surface);
-			}
-		}
-		~StandingState() {
-			while(textures.size()) {
-				if(textures.back()) SDL_DestroyTexture(textures.back());
-				textures.pop_back();
-			}
 		}
 		
 		//should not happen in this state
@@ -350,26 +363,27 @@ class Player {
 		void onCollideBottom() {
 		}
 		void onNoCollideBottom() {
-			parent->setState("jumping");
+			parent->setState(PLAYER_JUMPING);
 		}
 		//change facing and move to running
 		void onLeftDown() {
 			parent->setFacing(0);
-			parent->setState("running");
+			parent->setState(PLAYER_RUNNING);
 		}
 		//change facing and move to running
 		void onRightDown() {
 			parent->setFacing(1);
-			parent->setState("running");
+			parent->setState(PLAYER_RUNNING);
 		}
 		//go to crouching
 		void onDownDown() {
-			parent->setState("crouching");
+			parent->setState(PLAYER_CROUCHING);
 		}
 		//go to jumping
 		void onJump() {
-			parent->setState("jumping");
+			parent->setState(PLAYER_JUMPING);
 			parent->getCollision()->jump();
+			parent->playSound(SOUND_JUMP);
 		}
 		//do nothing
 		void onLeftUp() {
@@ -391,24 +405,10 @@ class Player {
 	};
 	class CrouchingState : public PlayerState {
 		public:
-		CrouchingState(SDL_Renderer *renderer, Player *parent) {
+		CrouchingState(Player *parent) {
 			filename = "crouching";
-			extension = ".png";
-			frames = 1;
-			framerate = 0;
-			this->renderer = renderer;
+			clip = parent->getAnimations()->findClip(filename);
 			this->parent = parent;
-			for(int i = 0; i < frames; i++) {
-				SDL_Surface *surface = IMG_Load((SPRITE_DIRECTORY + filename + std::to_string(i) + extension).c_str());
-				textures.push_back(SDL_CreateTextureFromSurface(renderer,surface));
-				SDL_FreeSurface(surface);
-			}
-		}
-		~CrouchingState() {
-			while(textures.size()) {
-				if(textures.back()) SDL_DestroyTexture(textures.back());
-				textures.pop_back();
-			}
 		}
 		
 		//should not happen in this state
@@ -439,7 +439,7 @@ class Player {
 		}
 		//go to standing
 		void onDownUp() {
-			parent->setState("standing");
+			parent->setState(PLAYER_STANDING);
 		}
 		
 		//do nothing
@@ -453,30 +453,20 @@ class Player {
 		}
 	};
 	class RunningState : public PlayerState {
+		private:
+		//animation frame the last footstep was played on
+		int stepFrame;
+		
 		public:
-		RunningState(SDL_Renderer *renderer, Player *parent) {
+		RunningState(Player *parent) {
 			filename = "running";
-			extension = ".png";
-			frames = 2;
-			framerate = 4;
-			this->renderer = renderer;
+			clip = parent->getAnimations()->findClip(filename);
 			this->parent = parent;
-			for(int i = 0; i < frames; i++) {
-				SDL_Surface *surface = IMG_Load((SPRITE_DIRECTORY + filename + std::to_string(i) + extension).c_str());
-				textures.push_back(SDL_CreateTextureFromSurface(renderer,surface));
-				SDL_FreeSurface(surface);
-			}
-		}
-		~RunningState() {
-			while(textures.size()) {
-				if(textures.back()) SDL_DestroyTexture(textures.back());
-				textures.pop_back();
-			}
 		}
 		
 		//go to standing
 		void onCollideFront() {
-			parent->setState("standing");
+			parent->setState(PLAYER_STANDING);
 		}
 		//should not happen
 		void onCollideTop() {
@@ -485,7 +475,7 @@ class Player {
 		}
 		//go to jumping
 		void onNoCollideBottom() {
-			parent->setState("jumping");
+			parent->setState(PLAYER_JUMPING);
 		}
 		//change facing
 		void onLeftDown() {
@@ -498,24 +488,25 @@ class Player {
 		}
 		//go to sliding
 		void onDownDown() {
-			parent->setState("sliding");
+			parent->setState(PLAYER_SLIDING);
 		}
 		//go to jumping and set yvel
 		void onJump() {
-			parent->setState("jumping");
+			parent->setState(PLAYER_JUMPING);
 			parent->getCollision()->jump();
+			parent->playSound(SOUND_JUMP);
 		}
 		//if facing is left, go to standing
 		void onLeftUp() {
 			if(!parent->getFacing()) {
-				parent->setState("standing");
+				parent->setState(PLAYER_STANDING);
 				parent->getCollision()->stop();
 			}
 		}
 		//if facing is right, go to standing
 		void onRightUp() {
 			if(parent->getFacing()) {
-				parent->setState("standing");
+				parent->setState(PLAYER_STANDING);
 				parent->getCollision()->stop();
 			}
 		}
@@ -523,13 +514,19 @@ class Player {
 		void onDownUp() {
 		}
 		
-		//move
+		//move, and step whenever the animation moves to a new frame
 		void onUpdate() {
 			parent->getCollision()->clearYVel();
 			parent->getCollision()->move(parent->getFacing());
 			parent->getCollision()->clearXAcc();
+			int frame = parent->getAnimations()->frameAt(clip, parent->getStateTicks());
+			if(frame != stepFrame) {
+				stepFrame = frame;
+				parent->playSound(SOUND_FOOTSTEP);
+			}
 		}
 		void onActive() {
+			stepFrame = -1;
 			parent->getCollision()->clearYVel();
 			parent->getCollision()->move(parent->getFacing());
 			parent->getCollision()->clearXAcc();
@@ -537,38 +534,26 @@ class Player {
 	};
 	class SlidingState : public PlayerState {
 		private:
-		//ticks when slide state was entered
-		unsigned int slideBeginTime;
-		//how long the slide lasts in ms
+		//updates since the slide began, counted so pauses and catching up don't change its length
+		unsigned int slideTicks;
+		//how long the slide lasts in ms, and in updates at the simulation's rate
 		unsigned int const slideDuration = 600;
+		unsigned int const slideDurationTicks = slideDuration*SIM_TICKS_PER_SECOND/1000;
 		
 		public:
-		SlidingState(SDL_Renderer *renderer, Player *parent) {
+		SlidingState(Player *parent) {
+			slideTicks = 0;
 			filename = "sliding";
-			extension = ".png";
-			frames = 1;
-			framerate = 0;
-			this->renderer = renderer;
+			clip = parent->getAnimations()->findClip(filename);
 			this->parent = parent;
-			for(int i = 0; i < frames; i++) {
-				SDL_Surface *surface = IMG_Load((SPRITE_DIRECTORY + filename + std::to_string(i) + extension).c_str());
-				textures.push_back(SDL_CreateTextureFromSurface(renderer,surface));
-				SDL_FreeSurface(surface);
-			}
-		}
-		~SlidingState() {
-			while(textures.size()) {
-				if(textures.back()) SDL_DestroyTexture(textures.back());
-				textures.pop_back();
-			}
 		}
 		
 		//go to crouching or standing
 		void onCollideFront() {
 			if(downDown)
-				parent->setState("crouching");
+				parent->setState(PLAYER_CROUCHING);
 			else
-				parent->setState("standing");
+				parent->setState(PLAYER_STANDING);
 		}
 		//should not happen
 		void onCollideTop() {
@@ -577,7 +562,7 @@ class Player {
 		}
 		//go to jumping
 		void onNoCollideBottom() {
-			parent->setState("jumping");
+			parent->setState(PLAYER_JUMPING);
 		}
 		void onLeftDown() {
 		}
@@ -600,12 +585,12 @@ class Player {
 			parent->getCollision()->clearYVel();
 			parent->getCollision()->slide(parent->getFacing());
 			parent->getCollision()->clearXAcc();
-			if(SDL_GetTicks() > slideBeginTime + slideDuration) {
+			if(++slideTicks > slideDurationTicks) {
 				if(downDown) {
-					parent->setState("crouching");
+					parent->setState(PLAYER_CROUCHING);
 				}
 				else if((rightDown || leftDown) && !(rightDown && leftDown)) {
-					parent->setState("running");
+					parent->setState(PLAYER_RUNNING);
 					if(rightDown) {
 						parent->setFacing(1);
 					}
@@ -614,13 +599,13 @@ class Player {
 					}
 				}
 				else {
-					parent->setState("standing");
+					parent->setState(PLAYER_STANDING);
 				}
 			}
 		}
-		//record current time, set holdingD/SButton to true
+		//start counting, set holdingD/SButton to true
 		void onActive() {
-			slideBeginTime = SDL_GetTicks();
+			slideTicks = 0;
 			parent->getCollision()->clearYVel();
 			parent->getCollision()->slide(parent->getFacing());
 			parent->getCollision()->clearXAcc();
@@ -628,27 +613,10 @@ class Player {
 	};
 	class JumpingState : public PlayerState {
 		public:
-		JumpingState(SDL_Renderer *renderer, Player *parent) {
+		JumpingState(Player *parent) {
 			filename = "jumping";
-			extension = ".png";
-			frames = 1;
-			framerate = 0;
-			this->renderer = renderer;
+			clip = parent->getAnimations()->findClip(filename);
 			this->parent = parent;
-			for(int i = 0; i < frames; i++) {
-				SDL_Surface *surface = IMG_Load((SPRITE_DIRECTORY + filename + std::to_string(i) + extension).c_str());
-				if(surface == NULL) {
-					printf("%s", SDL_GetError());
-				}
-				textures.push_back(SDL_CreateTextureFromSurface(renderer,surface));
-				SDL_FreeSurface(surface);
-			}
-		}
-		~JumpingState() {
-			while(textures.size()) {
-				if(textures.back()) SDL_DestroyTexture(textures.back());
-				textures.pop_back();
-			}
 		}
 		
 		//remove x velocity
@@ -664,22 +632,22 @@ class Player {
 			if(rightDown) {
 				if(leftDown) {
 					//if both directions down go to standing
-					parent->setState("standing");
+					parent->setState(PLAYER_STANDING);
 				}
 				else {
 					//if just d down go to running and facing=right
-					parent->setState("running");
+					parent->setState(PLAYER_RUNNING);
 					parent->setFacing(1);
 				}
 			}
 			else if(leftDown) {
 				//if just a down go to running and facing=left
-				parent->setState("running");
+				parent->setState(PLAYER_RUNNING);
 				parent->setFacing(0);
 			}
 			else {
 				//if no directions down go to standing
-				parent->setState("standing");
+				parent->setState(PLAYER_STANDING);
 			}
 		}
 		//do nothing
@@ -693,7 +661,8 @@ class Player {
 		}
 		//go to gliding
 		void onJump() {
-			parent->setState("gliding");
+			parent->setState(PLAYER_GLIDING);
+			parent->playSound(SOUND_GLIDE);
 		}
 		//do nothing
 		void onLeftUp() {
@@ -723,24 +692,10 @@ class Player {
 	};
 	class GlidingState : public PlayerState {
 		public:
-		GlidingState(SDL_Renderer *renderer, Player *parent) {
+		GlidingState(Player *parent) {
 			filename = "gliding";
-			extension = ".png";
-			frames = 1;
-			framerate = 0;
-			this->renderer = renderer;
+			clip = parent->getAnimations()->findClip(filename);
 			this->parent = parent;
-			for(int i = 0; i < frames; i++) {
-				SDL_Surface *surface = IMG_Load((SPRITE_DIRECTORY + filename + std::to_string(i) + extension).c_str());
-				textures.push_back(SDL_CreateTextureFromSurface(renderer,surface));
-				SDL_FreeSurface(surface);
-			}
-		}
-		~GlidingState() {
-			while(textures.size()) {
-				if(textures.back()) SDL_DestroyTexture(textures.back());
-				textures.pop_back();
-			}
 		}
 		
 		//remove x velocity
@@ -755,14 +710,14 @@ class Player {
 		void onCollideBottom() {
 			if(rightDown && !leftDown) {
 				parent->setFacing(1);
-				parent->setState("running");
+				parent->setState(PLAYER_RUNNING);
 			}
 			else if(!rightDown && leftDown) {
 				parent->setFacing(0);
-				parent->setState("running");
+				parent->setState(PLAYER_RUNNING);
 			}
 			else {
-				parent->setState("standing");
+				parent->setState(PLAYER_STANDING);
 			}
 		}
 		//do nothing
@@ -778,7 +733,7 @@ class Player {
 				parent->getCollision()->move(1);
 		}
 		void onDownDown() {
-			parent->setState("jumping");
+			parent->setState(PLAYER_JUMPING);
 		}
 		void onJump() {
 		}
@@ -817,17 +772,27 @@ class Player {
 	PlayerCollider *collision;
 	unsigned int inactiveTime;
 	unsigned int lastActiveTime;
+	//simulation ticks since the current state was entered, drives animation
+	unsigned int stateTicks;
+	SoundBank *sounds;
+	int soundIds[PLAYER_SOUND_COUNT];
 	
 	
 	public:
 	Player(SDL_Renderer *renderer, int x, int y, MapData *mapData, int tileSize) {
-		standing = new StandingState(renderer, this);
-		crouching = new CrouchingState(renderer, this);
-		running = new RunningState(renderer, this);
-		sliding = new SlidingState(renderer, this);
-		jumping = new JumpingState(renderer, this);
-		gliding = new GlidingState(renderer, this);
+		if(!playerAtlasUsers++) {
+			playerAnimations = new AnimationSet(ANIMATION_FILE);
+			playerAtlas = new SpriteAtlas(renderer, SPRITE_DIRECTORY, playerAnimations->getNames(), playerAnimations->getFrameCounts(), SPRITE_EXTENSION);
+		}
+		standing = new StandingState(this);
+		crouching = new CrouchingState(this);
+		running = new RunningState(this);
+		sliding = new SlidingState(this);
+		jumping = new JumpingState(this);
+		gliding = new GlidingState(this);
 		currentState = standing;
+		stateTicks = 0;
+		setSoundBank(nullptr);
 		inactiveTime = 0;
 		lastActiveTime = 0;
 		
@@ -840,7 +805,12 @@ class Player {
 		delete(running);
 		delete(jumping);
 		delete(gliding);
-		
+		if(!--playerAtlasUsers) {
+			delete(playerAtlas);
+			delete(playerAnimations);
+			playerAtlas = nullptr;
+			playerAnimations = nullptr;
+		}
 	}
 	
 	unsigned int readInactiveTime() {
@@ -866,26 +836,29 @@ class Player {
 		return rightFacing;
 	}
 	
-	void setState(std::string newState) {
-		if(newState == "standing") {
+	void setState(int newState) {
+		PlayerState *oldState = currentState;
+		if(newState == PLAYER_STANDING) {
 			currentState = standing;
 		}
-		else if(newState == "crouching") {
+		else if(newState == PLAYER_CROUCHING) {
 			currentState = crouching;
 		}
-		else if(newState == "running") {
+		else if(newState == PLAYER_RUNNING) {
 			currentState = running;
 		}
-		else if(newState == "sliding") {
+		else if(newState == PLAYER_SLIDING) {
 			currentState = sliding;
 		}
-		else if(newState == "jumping") {
+		else if(newState == PLAYER_JUMPING) {
 			currentState = jumping;
 		}
-		else if(newState == "gliding") {
+		else if(newState == PLAYER_GLIDING) {
 			currentState = gliding;
 		}
 		
+		if(currentState != oldState)
+			stateTicks = 0;
 		currentState->onActive();
 	}
 	
@@ -893,15 +866,60 @@ class Player {
 		currentState->draw(rect);
 	}
 	
+	/**
+	 * Draw a frame recorded earlier with getClip, getStateTicks and getFacing
+	 */
+	void draw(SDL_Rect rect, int clip, unsigned int stateTicks, bool rightFacing) {
+		playerAtlas->draw(rect, clip, playerAnimations->frameAt(clip, stateTicks), rightFacing);
+	}
+	
+	int getClip() {
+		return currentState->getClip();
+	}
+	
 	PlayerCollider *getCollision() {
 		return collision;
 	}
 	
+	SpriteAtlas *getAtlas() {
+		return playerAtlas;
+	}
+	
+	AnimationSet *getAnimations() {
+		return playerAnimations;
+	}
+	
+	unsigned int getStateTicks() {
+		return stateTicks;
+	}
+	
+	void setSoundBank(SoundBank *sounds) {
+		this->sounds = sounds;
+		for(int i = 0; i < PLAYER_SOUND_COUNT; i++) {
+			soundIds[i] = sounds ? sounds->find(PLAYER_SOUND_NAMES[i]) : -1;
+		}
+	}
+	
+	void playSound(int sound) {
+		if(sounds)
+			sounds->play(soundIds[sound]);
+	}
+	
 	void update() {
+		stateTicks++;
 		collision->update();
 		currentState->onUpdate();
 	}
 	
+	/**
+	 * Step by a fixed number of milliseconds, for the simulation's clock
+	 */
+	void update(double elapsedTime) {
+		stateTicks++;
+		collision->update(elapsedTime);
+		currentState->onUpdate();
+	}
+	
 	void changeTileSize(int tileSize) {
 		collision->changeTileSize(tileSize);
 	}
@@ -910,6 +928,17 @@ class Player {
 		return collision->getRect();
 	}
 	
+	/**
+	 * Entities the player can stand on and bump into this tick, owned by the caller
+	 */
+	void setPlatforms(std::vector<SDL_Rect> const *platforms) {
+		collision->setPlatforms(platforms);
+	}
+	
+	void carry(int dx, int dy) {
+		collision->shift(dx, dy);
+	}
+	
 	void onCollideLeft() {
 		if(!rightFacing){}
 			currentState->onCollideFront();
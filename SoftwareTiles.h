@@ -0,0 +1,347 @@
+//Draws tile layers straight into pixels, for when there's no GPU to draw them
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "SDL2/SDL.h"
+#include "GameData.h"
+#include "TextureCache.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TILE_BLIT_SSE2
+#endif
+//gcc and clang can build the AVX2 version alone, it's only used if the CPU has it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TILE_BLIT_AVX2
+#endif
+
+#ifndef SOFTWARETILES_H
+#define SOFTWARETILES_H
+
+/**
+ * How a tile's pixels go over what's under them. Opaque rows are copied,
+ * keyed rows skip fully transparent pixels and blended rows mix by alpha
+ */
+Uint8 const TILE_EMPTY = 0;
+Uint8 const TILE_OPAQUE = 1;
+Uint8 const TILE_KEYED = 2;
+Uint8 const TILE_BLENDED = 3;
+
+typedef void (*RowBlitter)(Uint32 *dst, Uint32 const *src, int count);
+
+/**
+ * Copy every pixel that isn't fully transparent, one at a time
+ */
+void blitKeyedRow(Uint32 *dst, Uint32 const *src, int count) {
+	for(int i = 0; i < count; i++) {
+		if(src[i] >> 24)
+			dst[i] = src[i];
+	}
+}
+
+#ifdef TILE_BLIT_SSE2
+/**
+ * Four pixels at a time, keeping what's under the ones with no alpha
+ */
+void blitKeyedRowSSE2(Uint32 *dst, Uint32 const *src, int count) {
+	__m128i const zero = _mm_setzero_si128();
+	int i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((__m128i const*)(src + i));
+		__m128i d = _mm_loadu_si128((__m128i const*)(dst + i));
+		__m128i clear = _mm_cmpeq_epi32(_mm_srli_epi32(s, 24), zero);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(clear, d), _mm_andnot_si128(clear, s)));
+	}
+	blitKeyedRow(dst + i, src + i, count - i);
+}
+#endif
+
+#ifdef TILE_BLIT_AVX2
+/**
+ * Eight pixels at a time
+ */
+__attribute__((target("avx2")))
+void blitKeyedRowAVX2(Uint32 *dst, Uint32 const *src, int count) {
+	__m256i const zero = _mm256_setzero_si256();
+	int i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((__m256i const*)(src + i));
+		__m256i d = _mm256_loadu_si256((__m256i const*)(dst + i));
+		__m256i clear = _mm256_cmpeq_epi32(_mm256_srli_epi32(s, 24), zero);
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_blendv_epi8(s, d, clear));
+	}
+	blitKeyedRow(dst + i, src + i, count - i);
+}
+#endif
+
+/**
+ * Mix every pixel over what's under it by its alpha, the same as SDL's blend mode.
+ * Only tiles with soft edges take this, so it's left plain
+ */
+void blitBlendedRow(Uint32 *dst, Uint32 const *src, int count) {
+	for(int i = 0; i < count; i++) {
+		Uint32 s = src[i];
+		Uint32 a = s >> 24;
+		if(a == 255) {
+			dst[i] = s;
+			continue;
+		}
+		if(!a)
+			continue;
+		Uint32 d = dst[i];
+		Uint32 out = (a + ((d >> 24)*(255 - a) + 127)/255) << 24;
+		for(int shift = 0; shift < 24; shift += 8) {
+			Uint32 mixed = ((s >> shift) & 0xFF)*a + ((d >> shift) & 0xFF)*(255 - a);
+			out |= ((mixed + 127)/255) << shift;
+		}
+		dst[i] = out;
+	}
+}
+
+/**
+ * The fastest keyed row blitter this CPU can run
+ */
+RowBlitter keyedRowBlitter() {
+#ifdef TILE_BLIT_AVX2
+	if(SDL_HasAVX2())
+		return blitKeyedRowAVX2;
+#endif
+#ifdef TILE_BLIT_SSE2
+	return blitKeyedRowSSE2;
+#else
+	return blitKeyedRow;
+#endif
+}
+
+char const *keyedRowBlitterName() {
+	RowBlitter blitter = keyedRowBlitter();
+#ifdef TILE_BLIT_AVX2
+	if(blitter == blitKeyedRowAVX2)
+		return "AVX2";
+#endif
+#ifdef TILE_BLIT_SSE2
+	if(blitter == blitKeyedRowSSE2)
+		return "SSE2";
+#endif
+	return "scalar";
+}
+
+/**
+ * Whether the renderer draws on the CPU, where every copy costs a blit
+ */
+bool rendersInSoftware(SDL_Renderer *renderer) {
+	SDL_RendererInfo info;
+	return SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE);
+}
+
+/**
+ * A screen sized streaming texture to draw pixels into, uploaded once a frame
+ */
+class SoftwareCanvas {
+	private:
+	SDL_Renderer *renderer;
+	SDL_Texture *texture;
+	int width;
+	int height;
+	//only while locked
+	Uint32 *pixels;
+	int pitch;
+
+	public:
+	SoftwareCanvas(SDL_Renderer *renderer) {
+		this->renderer = renderer;
+		texture = nullptr;
+		width = 0;
+		height = 0;
+		pixels = nullptr;
+		pitch = 0;
+		printf("Drawing tiles on the CPU, %s rows\n", keyedRowBlitterName());
+	}
+	~SoftwareCanvas() {
+		if(texture) SDL_DestroyTexture(texture);
+	}
+
+	/**
+	 * Lock the pixels for a frame of the given size, false if there's no texture to draw into
+	 */
+	bool begin(int width, int height) {
+		if(!texture || width != this->width || height != this->height) {
+			if(texture) SDL_DestroyTexture(texture);
+			this->width = width;
+			this->height = height;
+			texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+			if(!texture) {
+				printf("No streaming texture to draw tiles into: %s\n", SDL_GetError());
+				return false;
+			}
+			//whatever was drawn before is covered completely
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+		}
+		void *locked;
+		if(SDL_LockTexture(texture, NULL, &locked, &pitch) != 0)
+			return false;
+		pixels = (Uint32*)locked;
+		pitch /= sizeof(Uint32);
+		return true;
+	}
+
+	/**
+	 * Upload what was drawn and copy it over the screen
+	 */
+	void end() {
+		SDL_UnlockTexture(texture);
+		pixels = nullptr;
+		SDL_Rect rect = { 0, 0, width, height };
+		SDL_RenderCopy(renderer, texture, NULL, &rect);
+	}
+
+	Uint32 *getPixels() {
+		return pixels;
+	}
+	/**
+	 * Pixels from one row to the next
+	 */
+	int getPitch() {
+		return pitch;
+	}
+	int getW() {
+		return width;
+	}
+	int getH() {
+		return height;
+	}
+};
+
+/**
+ * A tileset's pixels scaled to the size tiles are drawn at, each tile stored
+ * in one piece, and whether each tile is empty, opaque, keyed or blended so
+ * a row of it takes the cheapest copy that gets it right
+ */
+class TileSheet {
+	private:
+	SDL_Surface *source;
+	int sourceSide;
+	int columns;
+	int count;
+	//scaled tiles, side*side pixels each, one after another
+	std::vector<Uint32> pixels;
+	std::vector<Uint8> kinds;
+	int side;
+	RowBlitter keyed;
+	//what each index currently draws as, for animated tiles
+	std::vector<int> const *remap;
+
+	public:
+	TileSheet(std::string filename, int sourceSide) {
+		source = decodeImage(filename, SDL_PIXELFORMAT_ARGB8888);
+		if(!source) {
+			printf("Couldn't read tileset '%s' for drawing on the CPU\n", filename.c_str());
+			throw;
+		}
+		this->sourceSide = sourceSide;
+		columns = source->w/sourceSide;
+		count = columns*(source->h/sourceSide);
+		side = 0;
+		keyed = keyedRowBlitter();
+		remap = nullptr;
+	}
+	~TileSheet() {
+		SDL_FreeSurface(source);
+	}
+
+	/**
+	 * Scale every tile to side pixels across, only when that changes
+	 */
+	void setTileSize(int side) {
+		if(side == this->side || side <= 0)
+			return;
+		this->side = side;
+		pixels.resize((size_t)count*side*side);
+		kinds.resize(count);
+		SDL_LockSurface(source);
+		int sourcePitch = source->pitch/sizeof(Uint32);
+		for(int tile = 0; tile < count; tile++) {
+			Uint32 const *from = (Uint32 const*)source->pixels + (tile/columns)*sourceSide*sourcePitch + (tile%columns)*sourceSide;
+			Uint32 *to = &pixels[(size_t)tile*side*side];
+			bool empty = true;
+			bool opaque = true;
+			bool keyable = true;
+			for(int y = 0; y < side; y++) {
+				Uint32 const *row = from + y*sourceSide/side*sourcePitch;
+				for(int x = 0; x < side; x++) {
+					Uint32 pixel = row[x*sourceSide/side];
+					Uint32 alpha = pixel >> 24;
+					empty = empty && alpha == 0;
+					opaque = opaque && alpha == 255;
+					keyable = keyable && (alpha == 0 || alpha == 255);
+					to[y*side + x] = pixel;
+				}
+			}
+			kinds[tile] = empty ? TILE_EMPTY : opaque ? TILE_OPAQUE : keyable ? TILE_KEYED : TILE_BLENDED;
+		}
+		SDL_UnlockSurface(source);
+	}
+
+	int tileSize() {
+		return side;
+	}
+
+	/**
+	 * Draw index i as (*remap)[i] from now on, indices past its end as themselves
+	 */
+	void setRemap(std::vector<int> const *remap) {
+		this->remap = remap;
+	}
+
+	/**
+	 * Draw one tile with its top left corner at x, y, clipped to the canvas
+	 */
+	void draw(SoftwareCanvas *canvas, int x, int y, int index) {
+		if(index < 0)
+			return;
+		if(remap && index < (int)remap->size())
+			index = (*remap)[index];
+		if(index < 0 || index >= count || kinds[index] == TILE_EMPTY)
+			return;
+		int left = std::max(0, -x);
+		int top = std::max(0, -y);
+		int right = std::min(side, canvas->getW() - x);
+		int bottom = std::min(side, canvas->getH() - y);
+		if(left >= right || top >= bottom)
+			return;
+		Uint32 const *from = &pixels[(size_t)index*side*side];
+		Uint32 *to = canvas->getPixels() + (y + top)*canvas->getPitch() + x;
+		int width = right - left;
+		Uint8 kind = kinds[index];
+		for(int row = top; row < bottom; row++, to += canvas->getPitch()) {
+			Uint32 const *src = from + row*side + left;
+			if(kind == TILE_OPAQUE)
+				memcpy(to + left, src, width*sizeof(Uint32));
+			else if(kind == TILE_KEYED)
+				keyed(to + left, src, width);
+			else
+				blitBlendedRow(to + left, src, width);
+		}
+	}
+
+	/**
+	 * Draw every tile of a layer that is on the canvas, offset by offX, offY
+	 */
+	void drawLayer(SoftwareCanvas *canvas, MapData *tiles, int offX, int offY) {
+		int x0 = std::max(floorDivide(-offX, side), tiles->getOriginX());
+		int y0 = std::max(floorDivide(-offY, side), tiles->getOriginY());
+		int x1 = std::min(floorDivide(canvas->getW() - 1 - offX, side), tiles->getOriginX() + tiles->getW() - 1);
+		int y1 = std::min(floorDivide(canvas->getH() - 1 - offY, side), tiles->getOriginY() + tiles->getH() - 1);
+		int **data = tiles->getData();
+		for(int y = y0; y <= y1; y++) {
+			int *row = data[y - tiles->getOriginY()];
+			for(int x = x0; x <= x1; x++) {
+				draw(canvas, offX + x*side, offY + y*side, row[x - tiles->getOriginX()]);
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,139 @@
+//Packs every frame of a character into a single texture
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+#include "AssetPack.h"
+
+#ifndef SPRITEATLAS_H
+#define SPRITEATLAS_H
+
+/**
+ * Mirror one region of a 32-bit surface left to right
+ */
+void mirrorRect(SDL_Surface *surface, SDL_Rect rect) {
+	SDL_LockSurface(surface);
+	for(int y = rect.y; y < rect.y + rect.h; y++) {
+		Uint32 *row = (Uint32*)((Uint8*)surface->pixels + y*surface->pitch);
+		int left = rect.x;
+		int right = rect.x + rect.w - 1;
+		while(left < right) {
+			Uint32 temp = row[left];
+			row[left] = row[right];
+			row[right] = temp;
+			left++;
+			right--;
+		}
+	}
+	SDL_UnlockSurface(surface);
+}
+
+/**
+ * A texture holding every frame of a set of animations, each one stored twice:
+ * once as drawn and once mirrored, so facing left is just a different source rect.
+ * Sheet s, frame f lives in row s, columns 2f (as drawn) and 2f+1 (mirrored)
+ */
+class SpriteAtlas {
+	private:
+	SDL_Texture *texture;
+	SDL_Renderer *renderer;
+	int sheets;
+	int maxFrames;
+	std::vector<SDL_Rect> cells;
+	
+	public:
+	SpriteAtlas(SDL_Renderer *renderer, std::string directory, std::vector<std::string> &names, std::vector<int> &frames, std::string extension) {
+		this->renderer = renderer;
+		this->sheets = names.size();
+		texture = nullptr;
+		
+		//load every frame up front so the cell size is known before packing
+		std::vector<SDL_Surface*> surfaces;
+		maxFrames = 0;
+		int cellW = 0;
+		int cellH = 0;
+		for(int s = 0; s < sheets; s++) {
+			if(frames[s] > maxFrames)
+				maxFrames = frames[s];
+			for(int f = 0; f < frames[s]; f++) {
+				SDL_Surface *loaded = loadImage(directory + names[s] + std::to_string(f) + extension);
+				SDL_Surface *surface = nullptr;
+				if(loaded == NULL) {
+					printf("%s", SDL_GetError());
+				}
+				else {
+					surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+					SDL_FreeSurface(loaded);
+				}
+				if(surface) {
+					cellW = surface->w > cellW ? surface->w : cellW;
+					cellH = surface->h > cellH ? surface->h : cellH;
+				}
+				surfaces.push_back(surface);
+			}
+		}
+		
+		//pack them, leaving missing frames as empty cells
+		cells.assign(sheets*maxFrames*2, { 0, 0, 0, 0 });
+		SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, cellW*maxFrames*2, cellH*sheets, 32, SDL_PIXELFORMAT_RGBA32);
+		if(!atlas) {
+			printf("Couldn't make the sprite atlas: %s\n", SDL_GetError());
+			for(unsigned int i = 0; i < surfaces.size(); i++) {
+				if(surfaces[i]) SDL_FreeSurface(surfaces[i]);
+			}
+			throw;
+		}
+		int loadedIndex = 0;
+		for(int s = 0; s < sheets; s++) {
+			for(int f = 0; f < frames[s]; f++) {
+				SDL_Surface *surface = surfaces.at(loadedIndex++);
+				if(!surface)
+					continue;
+				//copy alpha straight across rather than blending onto the empty atlas
+				SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+				SDL_Rect normal = { 2*f*cellW, s*cellH, surface->w, surface->h };
+				SDL_Rect mirrored = { (2*f+1)*cellW, s*cellH, surface->w, surface->h };
+				SDL_Rect dst = normal;
+				SDL_BlitSurface(surface, NULL, atlas, &dst);
+				dst = mirrored;
+				SDL_BlitSurface(surface, NULL, atlas, &dst);
+				mirrorRect(atlas, mirrored);
+				cells.at(cellIndex(s, f, 0)) = normal;
+				cells.at(cellIndex(s, f, 1)) = mirrored;
+				SDL_FreeSurface(surface);
+			}
+		}
+		texture = SDL_CreateTextureFromSurface(renderer, atlas);
+		SDL_FreeSurface(atlas);
+	}
+	~SpriteAtlas() {
+		if(texture) SDL_DestroyTexture(texture);
+	}
+	
+	int cellIndex(int sheet, int frame, bool mirrored) {
+		return (sheet*maxFrames + frame)*2 + (mirrored ? 1 : 0);
+	}
+	
+	/**
+	 * Where a frame lives in the atlas texture
+	 */
+	SDL_Rect getCell(int sheet, int frame, bool mirrored) {
+		if(sheet < 0 || sheet >= sheets || frame < 0 || frame >= maxFrames)
+			return { 0, 0, 0, 0 };
+		return cells[cellIndex(sheet, frame, mirrored)];
+	}
+	
+	void draw(SDL_Rect rect, int sheet, int frame, bool mirrored) {
+		SDL_Rect src = getCell(sheet, frame, mirrored);
+		if(src.w == 0)
+			return;
+		SDL_RenderCopy(renderer, texture, &src, &rect);
+	}
+	
+	SDL_Texture *getTexture() {
+		return texture;
+	}
+};
+
+#endif
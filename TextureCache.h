@@ -0,0 +1,199 @@
+//Keeps decoded images on disk in the renderer's own pixel format
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+#include <map>
+#include "AssetPack.h"
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+/**
+ * Where decoded images are kept between runs. Each cache file is a header,
+ * the source path, then the pixels exactly as they get uploaded
+ */
+std::string const TEXTURE_CACHE_DIRECTORY = "Cache/";
+char const TEXTURE_CACHE_MAGIC[4] = { 'O', 'T', 'C', 'T' };
+Uint32 const TEXTURE_CACHE_VERSION = 1;
+
+struct CachedTextureHeader {
+	char magic[4];
+	Uint32 version;
+	Sint64 modified;
+	Uint64 size;
+	Uint32 pathLength;
+	Uint32 format;
+	Sint32 w;
+	Sint32 h;
+	Sint32 pitch;
+};
+
+/**
+ * First format the renderer takes natively that keeps alpha, so uploads skip any conversion
+ */
+Uint32 nativeFormat(SDL_Renderer *renderer) {
+	SDL_RendererInfo info;
+	if(SDL_GetRendererInfo(renderer, &info) == 0) {
+		for(Uint32 i = 0; i < info.num_texture_formats; i++) {
+			if(SDL_ISPIXELFORMAT_ALPHA(info.texture_formats[i]))
+				return info.texture_formats[i];
+		}
+	}
+	return SDL_PIXELFORMAT_ARGB8888;
+}
+
+/**
+ * Cache file for a source path, named by its FNV-1a hash
+ */
+std::string texturePath(std::string path) {
+	Uint32 hash = 2166136261u;
+	for(unsigned int i = 0; i < path.length(); i++) {
+		hash ^= (Uint8)path[i];
+		hash *= 16777619u;
+	}
+	char name[16];
+	snprintf(name, sizeof(name), "%08x.tex", hash);
+	return TEXTURE_CACHE_DIRECTORY + name;
+}
+
+SDL_Texture *uploadPixels(SDL_Renderer *renderer, Uint32 format, int w, int h, void const *pixels, int pitch) {
+	SDL_Texture *texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, w, h);
+	if(!texture)
+		return nullptr;
+	SDL_UpdateTexture(texture, NULL, pixels, pitch);
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	return texture;
+}
+
+/**
+ * Try the cache, nullptr if there is no entry or it is out of date
+ */
+SDL_Surface *readCachedPixels(std::string path, Sint64 modified, Uint64 size, Uint32 format) {
+	FILE *fp = fopen(texturePath(path).c_str(), "rb");
+	if(!fp)
+		return nullptr;
+	SDL_Surface *surface = nullptr;
+	CachedTextureHeader header;
+	if(fread(&header, sizeof(header), 1, fp) == 1 && !memcmp(header.magic, TEXTURE_CACHE_MAGIC, 4) && header.version == TEXTURE_CACHE_VERSION
+	&& header.modified == modified && header.size == size && header.format == format && header.pathLength == path.length()
+	&& header.w > 0 && header.h > 0 && header.pitch >= header.w) {
+		//the hash could collide, so the stored path has to match too
+		std::string storedPath(header.pathLength, '\0');
+		if(fread(&storedPath[0], 1, header.pathLength, fp) == header.pathLength && storedPath == path) {
+			surface = SDL_CreateRGBSurfaceWithFormat(0, header.w, header.h, SDL_BITSPERPIXEL(format), format);
+			if(surface && (surface->pitch != header.pitch || fread(surface->pixels, header.pitch, header.h, fp) != (size_t)header.h)) {
+				SDL_FreeSurface(surface);
+				surface = nullptr;
+			}
+		}
+	}
+	fclose(fp);
+	return surface;
+}
+
+/**
+ * Store converted pixels, writing to a temporary file first so a crash never leaves half an entry
+ */
+void writeCachedTexture(std::string path, Sint64 modified, Uint64 size, SDL_Surface *surface) {
+#ifdef _WIN32
+	_mkdir(TEXTURE_CACHE_DIRECTORY.c_str());
+#else
+	mkdir(TEXTURE_CACHE_DIRECTORY.c_str(), 0755);
+#endif
+	std::string filename = texturePath(path);
+	std::string temp = filename + ".tmp";
+	FILE *fp = fopen(temp.c_str(), "wb");
+	if(!fp)
+		return;
+	CachedTextureHeader header;
+	memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+	header.version = TEXTURE_CACHE_VERSION;
+	header.modified = modified;
+	header.size = size;
+	header.pathLength = path.length();
+	header.format = surface->format->format;
+	header.w = surface->w;
+	header.h = surface->h;
+	header.pitch = surface->pitch;
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	ok = ok && fwrite(path.c_str(), 1, path.length(), fp) == path.length();
+	SDL_LockSurface(surface);
+	ok = ok && fwrite(surface->pixels, surface->pitch, surface->h, fp) == (size_t)surface->h;
+	SDL_UnlockSurface(surface);
+	ok = fclose(fp) == 0 && ok;
+	if(!ok) {
+		remove(temp.c_str());
+		return;
+	}
+	//rename won't replace an existing file on Windows
+	remove(filename.c_str());
+	rename(temp.c_str(), filename.c_str());
+}
+
+/**
+ * Pixels for an image in the given format, decoding the PNG only when the
+ * source has changed since it was last cached. Safe to call from any thread
+ * as long as no two threads ask for the same path at once
+ */
+SDL_Surface *decodeImage(std::string path, Uint32 format) {
+	Sint64 modified = 0;
+	Uint64 size = 0;
+	bool stamped = assetStamp(path, &modified, &size);
+	if(stamped) {
+		SDL_Surface *cached = readCachedPixels(path, modified, size, format);
+		if(cached)
+			return cached;
+	}
+	
+	SDL_Surface *loaded = loadImage(path);
+	if(!loaded)
+		return nullptr;
+	SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, format, 0);
+	SDL_FreeSurface(loaded);
+	if(surface && stamped)
+		writeCachedTexture(path, modified, size, surface);
+	return surface;
+}
+
+/**
+ * Images already decoded by the startup loader, waiting to be uploaded.
+ * Only touched on the main thread
+ */
+static std::map<std::string, SDL_Surface*> preloadedImages;
+
+void releasePreloaded() {
+	for(std::map<std::string, SDL_Surface*>::iterator it = preloadedImages.begin(); it != preloadedImages.end(); ++it) {
+		SDL_FreeSurface(it->second);
+	}
+	preloadedImages.clear();
+}
+
+SDL_Texture *surfaceToTexture(SDL_Renderer *renderer, SDL_Surface *surface) {
+	SDL_LockSurface(surface);
+	SDL_Texture *texture = uploadPixels(renderer, surface->format->format, surface->w, surface->h, surface->pixels, surface->pitch);
+	SDL_UnlockSurface(surface);
+	return texture;
+}
+
+/**
+ * Load an image straight into a texture, using the preloaded pixels if there are some
+ */
+SDL_Texture *loadTexture(SDL_Renderer *renderer, std::string path) {
+	std::map<std::string, SDL_Surface*>::iterator preloaded = preloadedImages.find(path);
+	if(preloaded != preloadedImages.end())
+		return surfaceToTexture(renderer, preloaded->second);
+	SDL_Surface *surface = decodeImage(path, nativeFormat(renderer));
+	if(!surface)
+		return nullptr;
+	SDL_Texture *texture = surfaceToTexture(renderer, surface);
+	SDL_FreeSurface(surface);
+	return texture;
+}
+
+#endif
@@ -0,0 +1,126 @@
+//Animated tiles, shown by remapping which tileset tile a map tile draws as
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+#include "SDL2/SDL.h"
+#include "AssetPack.h"
+
+#ifndef TILEANIMATION_H
+#define TILEANIMATION_H
+
+std::string const TILE_ANIMATIONS = "Data/Tileset.anim";
+
+/**
+ * Frame sequences read from the tileset's animation list, one per line as
+ * "<tile> <ms per frame> <frame tile> <frame tile>...". Maps keep the
+ * logical tile, and every frame the remap table says which tileset tile each
+ * logical tile draws as, so animating costs nothing per placed tile
+ */
+class TileAnimations {
+	private:
+	struct Sequence {
+		int tile;
+		Uint32 frameMs;
+		std::vector<int> frames;
+	};
+	std::vector<Sequence> sequences;
+	//logical tile to tileset tile, tiles past the end draw as themselves
+	std::vector<int> remap;
+	//which update each tile last changed on, so caches only redraw those,
+	//0 for tiles that never animate
+	std::vector<Uint32> changed;
+	std::vector<bool> animated;
+	Uint32 version;
+
+	public:
+	TileAnimations(std::string filename) {
+		version = 0;
+		char *text = loadText(filename);
+		if(!text) {
+			printf("No tile animations in '%s'\n", filename.c_str());
+			return;
+		}
+		char *cursor = text;
+		char *line;
+		while((line = nextLine(&cursor))) {
+			if(line[0] == '#')
+				continue;
+			Sequence sequence;
+			char *end;
+			sequence.tile = strtol(line, &end, 10);
+			if(end == line)
+				continue;
+			line = end;
+			sequence.frameMs = strtol(line, &end, 10);
+			bool negative = false;
+			for(line = end; ; line = end) {
+				int frame = strtol(line, &end, 10);
+				if(end == line)
+					break;
+				negative = negative || frame < 0;
+				sequence.frames.push_back(frame);
+			}
+			if(sequence.tile < 0 || !sequence.frameMs || sequence.frames.empty()) {
+				printf("Skipping tile animation for %d, it needs a frame time and frames\n", sequence.tile);
+				continue;
+			}
+			if(negative) {
+				printf("Skipping tile animation for %d, its frames can't be negative\n", sequence.tile);
+				continue;
+			}
+			if((int)remap.size() <= sequence.tile) {
+				int size = remap.size();
+				remap.resize(sequence.tile + 1);
+				for(int i = size; i <= sequence.tile; i++) {
+					remap[i] = i;
+				}
+				animated.resize(sequence.tile + 1, false);
+			}
+			animated[sequence.tile] = true;
+			sequences.push_back(sequence);
+		}
+		SDL_free(text);
+		changed.assign(remap.size(), 0);
+	}
+
+	/**
+	 * Move every sequence to its frame for the given time, returns whether anything changed
+	 */
+	bool update(Uint32 now) {
+		bool any = false;
+		for(unsigned int i = 0; i < sequences.size(); i++) {
+			Sequence const &sequence = sequences[i];
+			int frame = sequence.frames[now/sequence.frameMs % sequence.frames.size()];
+			if(remap[sequence.tile] != frame) {
+				if(!any)
+					version++;
+				any = true;
+				remap[sequence.tile] = frame;
+				changed[sequence.tile] = version;
+			}
+		}
+		return any;
+	}
+
+	std::vector<int> const *getRemap() {
+		return &remap;
+	}
+
+	bool isAnimated(int tile) {
+		return tile >= 0 && tile < (int)animated.size() && animated[tile];
+	}
+
+	/**
+	 * Whether a tile has drawn differently since the given version
+	 */
+	bool changedSince(int tile, Uint32 since) {
+		return tile >= 0 && tile < (int)changed.size() && changed[tile] > since;
+	}
+
+	Uint32 getVersion() {
+		return version;
+	}
+};
+
+#endif
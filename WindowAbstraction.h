@@ -5,6 +5,8 @@
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
 #include "SDL2/SDL_ttf.h"
+#include "AssetPack.h"
+#include "TextureCache.h"
 
 #ifndef WINDOWABSTRACTION_H
 #define WINDOWABSTRACTION_H
@@ -16,6 +18,14 @@ std::string const FONT_NAMES[] = { "Assets/TTF/Ubuntu-R.ttf", "Assets/TTF/AftaSe
 std::string const FONT_NAME = FONT_NAMES[1];
 int const FONT_SIZE = 64;
 
+/**
+ * Opened on first use and shared by every TextTile
+ */
+TTF_Font *sharedFont() {
+	static TTF_Font *font = loadFont(FONT_NAME, FONT_SIZE);
+	return font;
+}
+
 //Visual output
 //-------------------------------------------------------------------------
 /**
@@ -69,16 +79,19 @@ class TextTile : public MapTile {
 	public:
 	TextTile(std::string text, SDL_Renderer *renderer) {
 		this->renderer = renderer;
+		texture = nullptr;
 		setText(text);
 	}
+	~TextTile() {
+		if(texture) SDL_DestroyTexture(texture);
+	}
 	
 	void setText(std::string text) {
 		this->text = text;
-		TTF_Font *font = TTF_OpenFont(FONT_NAME.c_str(), FONT_SIZE);
-		SDL_Surface *surface = TTF_RenderText_Solid(font,text.c_str(), {0, 0, 0});
+		if(texture) SDL_DestroyTexture(texture);
+		SDL_Surface *surface = TTF_RenderText_Solid(sharedFont(),text.c_str(), {0, 0, 0});
 		texture = SDL_CreateTextureFromSurface(renderer, surface);
 		SDL_FreeSurface(surface);
-		TTF_CloseFont(font);
 	}
 	
 	void draw(SDL_Rect rect) {
@@ -92,11 +105,9 @@ class TextTile : public MapTile {
 class ImageTile : public MapTile {
 	public:
 	ImageTile(std::string filename, SDL_Renderer *renderer) {
-		SDL_Surface *surface =  IMG_Load(filename.c_str());
-		if(!surface) 
+		texture = loadTexture(renderer, filename);
+		if(!texture) 
 			throw;
-		texture = SDL_CreateTextureFromSurface(renderer, surface);
-		SDL_FreeSurface(surface);
 		this->renderer = renderer;
 	}
 	~ImageTile() {
@@ -118,17 +129,18 @@ class TilesetDrawer {
 	int w;
 	int h;
 	int squareSide;
+	//what each index currently draws as, for animated tiles
+	std::vector<int> const *remap;
 	
 	public:
 	TilesetDrawer(std::string filename, SDL_Renderer *renderer, int squareSide) {
-		SDL_Surface *surface =  IMG_Load(filename.c_str());
-		if(!surface) 
+		texture = loadTexture(renderer, filename);
+		if(!texture) 
 			throw;
-		texture = SDL_CreateTextureFromSurface(renderer, surface);
-		SDL_FreeSurface(surface);
 		this->renderer = renderer;
 		SDL_QueryTexture(texture, NULL, NULL, &w, &h);
 		this->squareSide = squareSide;
+		remap = nullptr;
 	}
 	~TilesetDrawer() {
 		SDL_DestroyTexture(texture);
@@ -137,6 +149,8 @@ class TilesetDrawer {
 	void draw(SDL_Rect rect, int index) {
 		if(index < 0)
 			return;
+		if(remap && index < (int)remap->size())
+			index = (*remap)[index];
 		SDL_Rect src;
 		src.w = squareSide;
 		src.h = squareSide;
@@ -166,27 +180,40 @@ class TilesetDrawer {
 	void setTileSize(int tileSize) {
 		squareSide = tileSize;
 	}
+	
+	/**
+	 * Draw index i as (*remap)[i] from now on, indices past its end as themselves
+	 */
+	void setRemap(std::vector<int> const *remap) {
+		this->remap = remap;
+	}
 };
 
 //Window Elements
 //-------------------------------------------------------------------------
 /**
  * This has a MapTile but also stores its location and can tell if it 
- * is clicked on
+ * is clicked on. It deletes the MapTile unless told it's owned elsewhere,
+ * like by an arena
  */
 class SpecificElement {
 	private:
 	SDL_Rect rect;
 	MapTile *element;
+	bool owned;
 	
 	
 	public:
-	SpecificElement(MapTile *element, SDL_Rect rect) {
+	SpecificElement(MapTile *element, SDL_Rect rect) : SpecificElement(element, rect, true) {
+	}
+	SpecificElement(MapTile *element, SDL_Rect rect, bool owned) {
 		this->element = element;
 		this->rect = rect;
+		this->owned = owned;
 	}
 	~SpecificElement() {
-		delete(element);
+		if(owned)
+			delete(element);
 	}
 	
 	bool click(int mouseX, int mouseY) {
@@ -6,6 +6,7 @@
 #include "SDL2/SDL_image.h"
 #include "SDL2/SDL_ttf.h"
 #include "WindowAbstraction.h"
+#include "Arena.h"
 
 #ifndef WINDOWSANDMENUS_H
 #define WINDOWSANDMENUS_H
@@ -13,7 +14,8 @@
 //Building blocks for menus
 //-------------------------------------------------------------------------
 /**
- * A button that changes color when hovered over
+ * A button that changes color when hovered over. Its parts are made in the
+ * same arena as it, which gets rid of them
  */
 class Button {
 	protected:
@@ -23,33 +25,37 @@ class Button {
 	bool hovered;
 	
 	public:
-	Button(SDL_Renderer *renderer, std::string buttonText, SDL_Color color1, SDL_Color color2, SDL_Rect rect) {
-		bg = new SpecificElement(new ColorTile(color1, renderer), rect);
-		bg2 = new SpecificElement(new ColorTile(color2, renderer), rect);
+	Button(Arena *arena, SDL_Renderer *renderer, std::string buttonText, SDL_Color color1, SDL_Color color2, SDL_Rect rect) {
+		bg = arena->make<SpecificElement>(arena->make<ColorTile>(color1, renderer), rect, false);
+		bg2 = arena->make<SpecificElement>(arena->make<ColorTile>(color2, renderer), rect, false);
 		int offX = rect.w/10;
 		int offY = rect.h/10;
-		text = new SpecificElement(new TextTile(buttonText, renderer), { rect.x+offX, rect.y+offY, rect.w-2*offX, rect.h-2*offY });
+		text = arena->make<SpecificElement>(arena->make<TextTile>(buttonText, renderer), SDL_Rect{ rect.x+offX, rect.y+offY, rect.w-2*offX, rect.h-2*offY }, false);
 		hovered = false;
 	}
-	~Button() {
-		if(bg) delete(bg);
-		if(bg2) delete(bg2);
-		if(text) delete(text);
-	}
 	
-	void hover(int mouseX, int mouseY) {
+	/**
+	 * Returns true if the button needs drawing again
+	 */
+	bool hover(int mouseX, int mouseY) {
+		bool was = hovered;
 		if(click(mouseX, mouseY)) {
 			hovered = true;
 		}
 		else {
 			hovered = false;
 		}
+		return hovered != was;
 	}
 	
 	bool click(int mouseX, int mouseY) {
 		return bg->click(mouseX, mouseY);
 	}
 	
+	SDL_Rect getRect() {
+		return bg->getRect();
+	}
+	
 	void draw() {
 		if(hovered) {
 			bg2->draw();
@@ -66,7 +72,9 @@ class Button {
  */
 class Visual {
 	public:
-	virtual std::string getTitle() = 0;
+	virtual ~Visual() {
+	}
+	virtual std::string const &getTitle() = 0;
 	virtual void draw() {
 	};
 	virtual void hover(int mouseX, int mouseY) {
@@ -77,14 +85,26 @@ class Visual {
 	}
 	virtual void handleInput(SDL_Event event) {
 	}
+	//anything kept in render targets has to be drawn again
+	virtual void invalidate() {
+	}
 };
 /**
  * Simple class for quick and easy menus
+ * Everything is drawn once into a cached texture and only buttons that change
+ * hover state get drawn again, so an idle menu is a single copy per frame.
+ * Menus are made in the window's menu arena and build their parts there too
  */
 class Menu : public Visual {
 	protected:
+	Arena *arena;
 	std::vector<SpecificElement*> elements;
 	std::vector<Button*> buttonVector;
+	//the background, panel and title, then all that plus the buttons
+	SDL_Texture *base;
+	SDL_Texture *composed;
+	bool composedValid;
+	std::vector<bool> staleButtons;
 	SDL_Renderer *renderer;
 	std::string title;
 	std::string background;
@@ -96,7 +116,8 @@ class Menu : public Visual {
 	std::string activeCommand;
 	
 	public:
-	Menu(SDL_Renderer *renderer, std::string title, std::string background, std::string activeCommand, int buttons, std::string buttonLabels[], int side, int screenWidth, int screenHeight) {
+	Menu(Arena *arena, SDL_Renderer *renderer, std::string title, std::string background, std::string activeCommand, int buttons, std::string buttonLabels[], int side, int screenWidth, int screenHeight) {
+		this->arena = arena;
 		this->renderer = renderer;
 		this->title = title;
 		this->background = background;
@@ -108,6 +129,9 @@ class Menu : public Visual {
 		this->SCREEN_WIDTH = screenWidth;
 		this->SCREEN_HEIGHT = screenHeight;
 		this->activeCommand = activeCommand;
+		base = nullptr;
+		composed = nullptr;
+		composedValid = false;
 		
 		build();
 	}
@@ -115,26 +139,26 @@ class Menu : public Visual {
 		destroy();
 	}
 	
-	std::string getTitle() {
+	std::string const &getTitle() {
 		return title;
 	}
 	
 	void destroy() {
-		while(elements.size()) {
-			if(elements.back()) delete(elements.back());
-			elements.pop_back();
-		}
-		while(buttonVector.size()) {
-			if(buttonVector.back()) delete(buttonVector.back());
-			elements.pop_back();
-		}
+		//the parts themselves go when the arena is reset
+		elements.clear();
+		buttonVector.clear();
+		if(base) SDL_DestroyTexture(base);
+		if(composed) SDL_DestroyTexture(composed);
+		base = nullptr;
+		composed = nullptr;
+		composedValid = false;
 	}
 	
 	void build() {
 		destroy();
 		
 		//add the background
-		elements.push_back(new SpecificElement(new ImageTile(background, renderer), { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT }));
+		elements.push_back(arena->make<SpecificElement>(arena->make<ImageTile>(background, renderer), SDL_Rect{ 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT }, false));
 		
 		//establish which part of the screen the menu buttons will occupy
 		SDL_Rect rect;
@@ -147,7 +171,7 @@ class Menu : public Visual {
 		else {
 			rect = { 2*SCREEN_WIDTH/3, 0, SCREEN_WIDTH/3, SCREEN_HEIGHT };
 		}
-		elements.push_back(new SpecificElement(new ColorTile({100,100,100,100}, renderer),rect));
+		elements.push_back(arena->make<SpecificElement>(arena->make<ColorTile>(SDL_Color{100,100,100,100}, renderer), rect, false));
 		//get each part of the menu its space rectangle
 		int verticalUnits = buttons + 1;
 		SDL_Rect subrect = rect;
@@ -155,23 +179,73 @@ class Menu : public Visual {
 		//add the title
 		int offX = subrect.w/10;
 		int offY = subrect.h/7;
-		elements.push_back(new SpecificElement(new TextTile(title, renderer), { subrect.x+offX, subrect.y+offY, subrect.w-2*offX, subrect.h-2*offY }));
+		elements.push_back(arena->make<SpecificElement>(arena->make<TextTile>(title, renderer), SDL_Rect{ subrect.x+offX, subrect.y+offY, subrect.w-2*offX, subrect.h-2*offY }, false));
 		//add the buttons
 		for(int i = 0; i < buttons; i++) {
 			subrect.y += subrect.h;
-			buttonVector.push_back(new Button(renderer, buttonLabels.at(i), { 150, 150, 150, 255 }, { 200, 200, 200, 255 }, { subrect.x+offX, subrect.y+offY, subrect.w-2*offX, subrect.h-2*offY } ));
-		}	
+			buttonVector.push_back(arena->make<Button>(arena, renderer, buttonLabels.at(i), SDL_Color{ 150, 150, 150, 255 }, SDL_Color{ 200, 200, 200, 255 }, SDL_Rect{ subrect.x+offX, subrect.y+offY, subrect.w-2*offX, subrect.h-2*offY } ));
+		}
+		staleButtons.assign(buttons, false);
+	}
+	
+	/**
+	 * Draw everything into the cached textures, false if render targets aren't available
+	 */
+	bool compose() {
+		if(!base)
+			base = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+		if(!composed)
+			composed = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+		SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+		if(!base || !composed || SDL_SetRenderTarget(renderer, base) != 0)
+			return false;
+		//the cached textures replace what is under them rather than blending
+		SDL_SetTextureBlendMode(base, SDL_BLENDMODE_NONE);
+		SDL_SetTextureBlendMode(composed, SDL_BLENDMODE_NONE);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+		for(unsigned int i = 0; i < elements.size(); i++) {
+			elements.at(i)->draw();
+		}
+		SDL_SetRenderTarget(renderer, composed);
+		SDL_RenderCopy(renderer, base, NULL, NULL);
+		for(int i = 0; i < buttons; i++) {
+			buttonVector.at(i)->draw();
+			staleButtons[i] = false;
+		}
+		SDL_SetRenderTarget(renderer, previous);
+		composedValid = true;
+		return true;
+	}
+	
+	/**
+	 * Put back the piece of the base under a button and draw the button over it
+	 */
+	void redrawButton(int i) {
+		SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+		SDL_SetRenderTarget(renderer, composed);
+		SDL_Rect rect = buttonVector.at(i)->getRect();
+		SDL_RenderCopy(renderer, base, &rect, &rect);
+		buttonVector.at(i)->draw();
+		SDL_SetRenderTarget(renderer, previous);
+		staleButtons[i] = false;
+	}
+	
+	void invalidate() {
+		composedValid = false;
 	}
 	
 	void hover(int mouseX, int mouseY) {
 		for(int i = 0; i < buttons; i++) {
-			buttonVector.at(i)->hover(mouseX, mouseY);
+			if(buttonVector.at(i)->hover(mouseX, mouseY))
+				staleButtons[i] = true;
 		}
 	}
 	
 	void resize(int width, int height) {
 		SCREEN_WIDTH = width;
 		SCREEN_HEIGHT = height;
+		//the old parts stay in the arena until the window builds its menus again
 		build();
 	}
 	
@@ -187,6 +261,15 @@ class Menu : public Visual {
 	}
 	
 	void draw() {
+		if(composedValid || compose()) {
+			for(int i = 0; i < buttons; i++) {
+				if(staleButtons[i])
+					redrawButton(i);
+			}
+			SDL_RenderCopy(renderer, composed, NULL, NULL);
+			return;
+		}
+		//no render targets, so draw it all every frame
 		for(unsigned int i = 0; i < elements.size(); i++) {
 			elements.at(i)->draw();
 		}
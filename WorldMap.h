@@ -0,0 +1,297 @@
+//Maps laid out together as one big world, streamed in a chunk at a time
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include "SDL2/SDL.h"
+#include "GameData.h"
+#include "JobSystem.h"
+
+#ifndef WORLDMAP_H
+#define WORLDMAP_H
+
+/**
+ * Chunks are square, in tiles. Only the chunks within STREAM_RADIUS of the
+ * one being followed are kept, and the player has to be STREAM_HYSTERESIS
+ * tiles past a chunk's edge before the window moves, so walking back and
+ * forth over a border doesn't reload anything
+ */
+int const CHUNK_TILES = 32;
+int const STREAM_RADIUS = 1;
+int const STREAM_SPAN = 2*STREAM_RADIUS + 1;
+int const STREAM_HYSTERESIS = 4;
+
+/**
+ * A map file and where its top left tile sits in the world
+ */
+struct MapPlacement {
+	std::string map;
+	int x;
+	int y;
+};
+
+/**
+ * The world's layout. Only the map headers are read up front, tiles are
+ * read straight out of the map files a chunk at a time
+ */
+class WorldMap {
+	private:
+	struct PlacedMap {
+		std::string filename;
+		int x;
+		int y;
+		int w;
+		int h;
+		//where the collision layer's rows start, the only layer worlds stream
+		Sint64 rows;
+	};
+	std::vector<PlacedMap> maps;
+	int w;
+	int h;
+
+	public:
+	WorldMap(std::vector<MapPlacement> const &places) {
+		w = 0;
+		h = 0;
+		for(unsigned int i = 0; i < places.size(); i++) {
+			SDL_RWops *rw = openAsset(places[i].map);
+			if(!rw) {
+				printf("Could not open world map '%s'\n", places[i].map.c_str());
+				continue;
+			}
+			PlacedMap placed = { places[i].map, places[i].x, places[i].y, 0, 0, 0 };
+			bool valid = readMapHeader(rw, &placed.w, &placed.h, &placed.rows);
+			SDL_RWclose(rw);
+			if(!valid || placed.x < 0 || placed.y < 0) {
+				printf("Skipping '%s', it is damaged or placed above or left of 0,0\n", placed.filename.c_str());
+				continue;
+			}
+			w = std::max(w, placed.x + placed.w);
+			h = std::max(h, placed.y + placed.h);
+			maps.push_back(placed);
+		}
+	}
+
+	/**
+	 * Size of the world in tiles
+	 */
+	int getW() {
+		return w;
+	}
+	int getH() {
+		return h;
+	}
+
+	/**
+	 * Copy chunk cx, cy into the window with its top left tile at left, top.
+	 * Anywhere no map covers is left empty
+	 */
+	void readChunk(int cx, int cy, MapData *window, int left, int top) {
+		int **rows = window->getData();
+		for(int y = 0; y < CHUNK_TILES; y++) {
+			std::fill(rows[top + y] + left, rows[top + y] + left + CHUNK_TILES, -1);
+		}
+		int chunkX = cx*CHUNK_TILES;
+		int chunkY = cy*CHUNK_TILES;
+		for(unsigned int i = 0; i < maps.size(); i++) {
+			PlacedMap const &map = maps[i];
+			int x0 = std::max(chunkX, map.x);
+			int x1 = std::min(chunkX + CHUNK_TILES, map.x + map.w);
+			int y0 = std::max(chunkY, map.y);
+			int y1 = std::min(chunkY + CHUNK_TILES, map.y + map.h);
+			if(x0 >= x1 || y0 >= y1)
+				continue;
+			SDL_RWops *rw = openAsset(map.filename);
+			if(!rw)
+				continue;
+			//each row of the overlap is one seek and one read
+			for(int y = y0; y < y1; y++) {
+				SDL_RWseek(rw, map.rows + ((Sint64)(y - map.y)*map.w + (x0 - map.x))*sizeof(int), RW_SEEK_SET);
+				SDL_RWread(rw, rows[top + y - chunkY] + left + x0 - chunkX, sizeof(int), x1 - x0);
+			}
+			SDL_RWclose(rw);
+		}
+	}
+};
+
+/**
+ * A window of STREAM_SPAN by STREAM_SPAN chunks kept centered on whatever it
+ * follows. The window is an ordinary MapData with its origin set, so tile
+ * collision and drawing work across chunk borders in world coordinates.
+ * Memory stays the same however big the world is
+ */
+class WorldStreamer {
+	private:
+	WorldMap *world;
+	MapData *window;
+	int centerX;
+	int centerY;
+	bool loaded;
+	//chunks being read on the job system for the center at target, see followAhead
+	MapData *staged;
+	JobCounter streaming;
+	bool pending;
+	int targetX;
+	int targetY;
+
+	static void streamChunks(void *data, int, int) {
+		WorldStreamer *streamer = (WorldStreamer*)data;
+		streamer->readChunks(streamer->targetX, streamer->targetY, streamer->staged);
+	}
+
+	/**
+	 * Whether chunk i, j of the window around cx, cy is already in the current window
+	 */
+	bool kept(int cx, int cy, int i, int j) {
+		int shiftX = cx - centerX;
+		int shiftY = cy - centerY;
+		return loaded && i + shiftX >= 0 && i + shiftX < STREAM_SPAN && j + shiftY >= 0 && j + shiftY < STREAM_SPAN;
+	}
+
+	/**
+	 * Read the chunks the window around cx, cy needs that it doesn't have yet, each into its place in the window
+	 */
+	void readChunks(int cx, int cy, MapData *into) {
+		for(int j = 0; j < STREAM_SPAN; j++) {
+			for(int i = 0; i < STREAM_SPAN; i++) {
+				if(!kept(cx, cy, i, j))
+					world->readChunk(cx - STREAM_RADIUS + i, cy - STREAM_RADIUS + j, into, i*CHUNK_TILES, j*CHUNK_TILES);
+			}
+		}
+	}
+
+	/**
+	 * The chunk to center on for world pixel x, y, false while the current one still covers it
+	 */
+	bool chunkFor(int x, int y, int tileSize, int *cx, int *cy) {
+		int tileX = floorDivide(x, tileSize);
+		int tileY = floorDivide(y, tileSize);
+		if(loaded) {
+			int intoX = tileX - centerX*CHUNK_TILES;
+			int intoY = tileY - centerY*CHUNK_TILES;
+			if(intoX >= -STREAM_HYSTERESIS && intoX < CHUNK_TILES + STREAM_HYSTERESIS
+				&& intoY >= -STREAM_HYSTERESIS && intoY < CHUNK_TILES + STREAM_HYSTERESIS)
+				return false;
+		}
+		*cx = floorDivide(tileX, CHUNK_TILES);
+		*cy = floorDivide(tileY, CHUNK_TILES);
+		return true;
+	}
+
+	/**
+	 * Move the window so chunk cx, cy is in the middle. Chunks still in range
+	 * are shifted over rather than read again, the rest come from ready if it
+	 * has them and straight from the maps if not
+	 */
+	void recenter(int cx, int cy, MapData *ready) {
+		int shiftX = cx - centerX;
+		int shiftY = cy - centerY;
+		bool keep = loaded && abs(shiftX) < STREAM_SPAN && abs(shiftY) < STREAM_SPAN;
+		int size = STREAM_SPAN*CHUNK_TILES;
+		int **rows = window->getData();
+		if(keep) {
+			//rows only need their pointers rotated, columns are moved within each row
+			if(shiftY > 0)
+				std::rotate(rows, rows + shiftY*CHUNK_TILES, rows + size);
+			else if(shiftY < 0)
+				std::rotate(rows, rows + size + shiftY*CHUNK_TILES, rows + size);
+			for(int y = 0; shiftX && y < size; y++) {
+				if(shiftX > 0)
+					memmove(rows[y], rows[y] + shiftX*CHUNK_TILES, (size - shiftX*CHUNK_TILES)*sizeof(int));
+				else
+					memmove(rows[y] - shiftX*CHUNK_TILES, rows[y], (size + shiftX*CHUNK_TILES)*sizeof(int));
+			}
+		}
+		window->setOrigin((cx - STREAM_RADIUS)*CHUNK_TILES, (cy - STREAM_RADIUS)*CHUNK_TILES);
+		if(!ready) {
+			readChunks(cx, cy, window);
+		}
+		else {
+			int **from = ready->getData();
+			for(int j = 0; j < STREAM_SPAN; j++) {
+				for(int i = 0; i < STREAM_SPAN; i++) {
+					if(kept(cx, cy, i, j))
+						continue;
+					for(int y = j*CHUNK_TILES; y < (j + 1)*CHUNK_TILES; y++) {
+						memcpy(rows[y] + i*CHUNK_TILES, from[y] + i*CHUNK_TILES, CHUNK_TILES*sizeof(int));
+					}
+				}
+			}
+		}
+		centerX = cx;
+		centerY = cy;
+		loaded = true;
+	}
+
+	public:
+	WorldStreamer(WorldMap *world) {
+		this->world = world;
+		window = new MapData(STREAM_SPAN*CHUNK_TILES, STREAM_SPAN*CHUNK_TILES);
+		centerX = 0;
+		centerY = 0;
+		loaded = false;
+		staged = nullptr;
+		SDL_AtomicSet(&streaming.pending, 0);
+		pending = false;
+		targetX = 0;
+		targetY = 0;
+	}
+	~WorldStreamer() {
+		if(pending)
+			jobSystem->wait(&streaming);
+		delete(window);
+		if(staged) delete(staged);
+	}
+
+	/**
+	 * The streamed tiles, the same object for as long as the streamer lives
+	 */
+	MapData *getMap() {
+		return window;
+	}
+
+	/**
+	 * Keep the chunks around world pixel x, y loaded
+	 */
+	void follow(int x, int y, int tileSize) {
+		int cx;
+		int cy;
+		if(chunkFor(x, y, tileSize, &cx, &cy))
+			recenter(cx, cy, nullptr);
+	}
+
+	/**
+	 * Like follow, but the chunks coming into range are read on the job system
+	 * and moved in on a later call once they're there. The window reaches a
+	 * chunk past the hysteresis on every side, so it still covers the view
+	 * while they're read. Only the first fill waits, there's nothing to show before it
+	 */
+	void followAhead(int x, int y, int tileSize) {
+		//with no other thread to read on, the job would only run when someone waits for it
+		if(!jobSystem || jobSystem->getThreadCount() < 2) {
+			follow(x, y, tileSize);
+			return;
+		}
+		if(pending) {
+			if(SDL_AtomicGet(&streaming.pending) > 0)
+				return;
+			recenter(targetX, targetY, staged);
+			pending = false;
+		}
+		if(!chunkFor(x, y, tileSize, &targetX, &targetY))
+			return;
+		if(!staged)
+			staged = new MapData(STREAM_SPAN*CHUNK_TILES, STREAM_SPAN*CHUNK_TILES);
+		pending = true;
+		jobSystem->submit(streamChunks, this, 0, 1, &streaming);
+		if(!loaded) {
+			jobSystem->wait(&streaming);
+			recenter(targetX, targetY, staged);
+			pending = false;
+		}
+	}
+};
+
+#endif